@@ -1,4 +1,4 @@
 # -*- coding: utf-8 -*-
 # thanks to: https://github.com/pybind/scikit_build_example
 
-from ._core import __doc__, VidBgPack, GetVideoBackground, HighlightObjectsPack, AssignObjectsPack, VidObjectTrackPack, TrackObjects
\ No newline at end of file
+from ._core import __doc__, VidBgPack, GetVideoBackground, GetVideoSetBackground, MergeBackgroundCheckpoints, HighlightObjectsPack, AssignObjectsPack, VidObjectTrackPack, TrackObjects
\ No newline at end of file
@@ -0,0 +1,779 @@
+// collects a histogram of values for each element of a cv::Mat sequence
+
+#ifndef ELEMENT_HISTOGRAMS_2390876_H
+#define ELEMENT_HISTOGRAMS_2390876_H
+
+//local headers
+#include "cv_util.h"
+#include "exception_assert.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/// statistics that can be extracted from element-wise histograms
+enum class HistogramStatType
+{
+    PERCENTILE,
+    MODE,
+    TRIMMED_MEAN,
+    INTERQUARTILE_RANGE,
+    MEDIAN_ABSOLUTE_DEVIATION
+};
+
+/// what to do when a histogram bin is full
+enum class HistogramOverflow
+{
+    /// the bin stops counting (statistics lose accuracy once bins saturate)
+    SATURATE,
+    /// all the element's bins are halved so the bin can keep counting (statistics use relative counts)
+    HALVE
+};
+
+/// a statistic to extract from element-wise histograms
+struct HistogramStatistic
+{
+    /// type of statistic
+    HistogramStatType type{HistogramStatType::PERCENTILE};
+    /// percentile (0 - 100) for PERCENTILE, percent trimmed from each tail (0 - 50) for TRIMMED_MEAN, unused otherwise
+    double parameter{50.0};
+};
+
+////
+// element-wise histograms of unsigned char cv::Mats
+// - there is one histogram per cv::Mat element (pixel channel), with one bin per unsigned char value
+// - the histograms are stored bin-major (parent vector is bins, child vector is all image elements)
+// - bins do not roll over; a full bin either stops counting or halves its element's histogram (see HistogramOverflow)
+// - statistics are extracted from the counts in each histogram, so halved histograms behave like unhalved ones
+///
+template <typename T>
+class ElementHistograms final
+{
+public:
+//constructors
+    /// default constructor: default
+    ElementHistograms() = default;
+
+    /// normal constructor
+    explicit ElementHistograms(const HistogramOverflow overflow_policy) : m_overflow_policy{overflow_policy}
+    {}
+
+    /// copy constructor: disabled
+    ElementHistograms(const ElementHistograms&) = delete;
+
+    /// move constructor: default
+    ElementHistograms(ElementHistograms&&) = default;
+
+//destructor: not needed (final class)
+
+//overloaded operators
+    /// copy assignment operator: disabled
+    ElementHistograms& operator=(const ElementHistograms&) = delete;
+
+    /// move assignment operator: default
+    ElementHistograms& operator=(ElementHistograms&&) = default;
+
+//member functions
+    /// increment histograms with the elements of a frame (all frames must have the same dimensions)
+    void ConsumeMat(const cv::Mat &frame)
+    {
+        static_assert(std::is_unsigned<T>::value, "ElementHistograms only works with unsigned integrals for histogram elements!");
+
+        // ignore frames that are corrupted
+        if (!frame.data || frame.empty())
+            return;
+
+        EXCEPTION_ASSERT(frame.depth() == CV_8U);
+
+        // collect frame info from first frame
+        if (m_frames_counted == 0)
+        {
+            m_frame_rows_count = frame.rows;
+            m_frame_channel_count = frame.channels();
+
+            Initialize(frame.total()*frame.channels());
+        }
+
+        EXCEPTION_ASSERT(frame.total()*frame.channels() == NumElements());
+
+        // increment all the histograms (rows are read in place, so a frame may be a view into a larger frame)
+        const int num_rows{frame.isContinuous() ? 1 : frame.rows};
+        const std::size_t row_elements{NumElements() / num_rows};
+        std::size_t element_index{0};
+
+        for (int row{0}; row < num_rows; row++)
+        {
+            const unsigned char *values{frame.ptr<unsigned char>(row)};
+
+            for (std::size_t row_element{0}; row_element < row_elements; row_element++, element_index++)
+            {
+                T &bin{m_histograms[static_cast<std::size_t>(values[row_element])][element_index]};
+
+                // make room in the element's histogram if the bin would roll over
+                if (bin == static_cast<T>(-1) && m_overflow_policy == HistogramOverflow::HALVE)
+                    HalveElement(element_index);
+
+                // only increment histogram if it won't cause roll-over
+                if (bin != static_cast<T>(-1))
+                    bin++;
+            }
+        }
+
+        m_frames_counted++;
+    }
+
+    /// decrement histograms with the elements of a frame that was consumed before (for sliding windows)
+    /// - only exact with the SATURATE policy when no bin has saturated
+    void RemoveMat(const cv::Mat &frame)
+    {
+        // ignore frames that are corrupted
+        if (!frame.data || frame.empty() || m_frames_counted == 0)
+            return;
+
+        EXCEPTION_ASSERT(frame.depth() == CV_8U);
+        EXCEPTION_ASSERT(frame.total()*frame.channels() == NumElements());
+
+        // decrement all the histograms (rows are read in place)
+        const int num_rows{frame.isContinuous() ? 1 : frame.rows};
+        const std::size_t row_elements{NumElements() / num_rows};
+        std::size_t element_index{0};
+
+        for (int row{0}; row < num_rows; row++)
+        {
+            const unsigned char *values{frame.ptr<unsigned char>(row)};
+
+            for (std::size_t row_element{0}; row_element < row_elements; row_element++, element_index++)
+            {
+                T &bin{m_histograms[static_cast<std::size_t>(values[row_element])][element_index]};
+
+                // don't roll under
+                if (bin != 0)
+                    bin--;
+            }
+        }
+
+        m_frames_counted--;
+    }
+
+    /// add the counts of another set of histograms to this one (dimensions must match)
+    void Merge(const ElementHistograms &other)
+    {
+        // nothing to merge
+        if (other.m_frames_counted == 0)
+            return;
+
+        // merging into empty histograms is a copy
+        if (m_frames_counted == 0)
+        {
+            m_frame_rows_count = other.m_frame_rows_count;
+            m_frame_channel_count = other.m_frame_channel_count;
+            m_histograms = other.m_histograms;
+            m_frames_counted = other.m_frames_counted;
+
+            return;
+        }
+
+        EXCEPTION_ASSERT(m_frame_rows_count == other.m_frame_rows_count);
+        EXCEPTION_ASSERT(m_frame_channel_count == other.m_frame_channel_count);
+        EXCEPTION_ASSERT(NumElements() == other.NumElements());
+
+        if (m_overflow_policy == HistogramOverflow::HALVE)
+            MergeWithHalving(other);
+        else
+            MergeWithSaturation(other);
+
+        m_frames_counted += other.m_frames_counted;
+    }
+
+    /// collect a percentile (0 - 100) from histograms
+    std::vector<unsigned char> PercentileFromHistograms(const double percentile) const
+    {
+        return StatisticFromHistograms(HistogramStatistic{HistogramStatType::PERCENTILE, percentile});
+    }
+
+    /// collect median from histograms
+    std::vector<unsigned char> MedianFromHistograms() const
+    {
+        return PercentileFromHistograms(50.0);
+    }
+
+    /// collect a statistic from histograms
+    /// - elements are split into ranges extracted in parallel (see SetExtractionThreads())
+    std::vector<unsigned char> StatisticFromHistograms(const HistogramStatistic &statistic) const
+    {
+        assert(m_histograms.size() > 0);
+        assert(m_histograms[0].size() > 0);
+
+        // validate here, since the extraction kernels may run in other threads
+        if (statistic.type == HistogramStatType::PERCENTILE)
+            EXCEPTION_ASSERT(statistic.parameter >= 0.0 && statistic.parameter <= 100.0);
+        if (statistic.type == HistogramStatType::TRIMMED_MEAN)
+            EXCEPTION_ASSERT(statistic.parameter >= 0.0 && statistic.parameter < 50.0);
+
+        std::vector<unsigned char> return_vec{};
+        return_vec.resize(NumElements());
+
+        ExtractInParallel(
+                [this, &statistic, &return_vec](const std::size_t begin, const std::size_t end)
+                {
+                    StatisticKernel(statistic, return_vec.data() + begin, begin, end);
+                }
+            );
+
+        return return_vec;
+    }
+
+    /// set how many threads may be used to extract statistics (e.g. processing threads that are idle after the last frame)
+    void SetExtractionThreads(const int num_threads)
+    {
+        m_extraction_threads = num_threads > 1 ? num_threads : 1;
+    }
+
+    /// get element-wise statistic as an image with the dimensions of the consumed frames
+    cv::Mat Statistic(const HistogramStatistic &statistic) const
+    {
+        if (m_frames_counted == 0)
+            return cv::Mat{};
+
+        // collect histogram results
+        std::vector<unsigned char> result_vec{StatisticFromHistograms(statistic)};
+
+        // convert vector to Mat image
+        cv::Mat result_frame{};
+        cv_mat_from_std_vector_uchar(result_frame, result_vec, m_frame_rows_count, m_frame_channel_count);
+
+        return result_frame;
+    }
+
+    /// get element-wise median as an image with the dimensions of the consumed frames
+    cv::Mat Median() const
+    {
+        return Statistic(HistogramStatistic{HistogramStatType::PERCENTILE, 50.0});
+    }
+
+    /// get element-wise statistics as images (an empty set of statistics means 'median only')
+    std::vector<cv::Mat> Statistics(const std::vector<HistogramStatistic> &statistics) const
+    {
+        std::vector<cv::Mat> images{};
+
+        if (statistics.empty())
+            images.emplace_back(Median());
+
+        for (const auto &statistic : statistics)
+            images.emplace_back(Statistic(statistic));
+
+        return images;
+    }
+
+    /// number of elements with a histogram (rows x cols x channels)
+    std::size_t NumElements() const
+    {
+        return m_histograms.size() ? m_histograms[0].size() : 0;
+    }
+
+    /// number of frames added to the histograms (including merged histograms)
+    long long FramesCounted() const { return m_frames_counted; }
+
+    /// number of pixel rows in the consumed frames
+    int FrameRows() const { return m_frame_rows_count; }
+
+    /// number of channels in the consumed frames
+    int FrameChannels() const { return m_frame_channel_count; }
+
+    /// what happens when a bin is full
+    HistogramOverflow OverflowPolicy() const { return m_overflow_policy; }
+
+    /// counts in one bin for all elements (NumElements() counts, for serialization)
+    const T* BinCounts(const std::size_t bin) const
+    {
+        assert(bin < m_histograms.size());
+
+        return m_histograms[bin].data();
+    }
+
+    /// writable counts in one bin for all elements (for deserialization, see Restore())
+    T* MutableBinCounts(const std::size_t bin)
+    {
+        assert(bin < m_histograms.size());
+
+        return m_histograms[bin].data();
+    }
+
+    /// replace the histograms with zeroed histograms for frames of the given shape that count as 'frames_counted' frames
+    /// - the bins must then be filled in with MutableBinCounts()
+    void Restore(const int frame_rows, const int frame_channels, const std::size_t num_elements, const long long frames_counted)
+    {
+        EXCEPTION_ASSERT(frame_rows > 0 && frame_channels > 0 && frames_counted > 0);
+        EXCEPTION_ASSERT(num_elements % static_cast<std::size_t>(frame_rows*frame_channels) == 0);
+
+        m_frame_rows_count = frame_rows;
+        m_frame_channel_count = frame_channels;
+        m_frames_counted = frames_counted;
+
+        Initialize(num_elements);
+    }
+
+    /// forget all frames (releases histogram memory)
+    void Reset()
+    {
+        m_frame_rows_count = 0;
+        m_frame_channel_count = 0;
+        m_frames_counted = 0;
+        m_histograms = std::vector<std::vector<T>>{};
+    }
+
+private:
+//member types
+    /// accumulated counts of one element's histogram (256 full bins must fit)
+    using accumulator_type = typename std::conditional<(sizeof(T) < 4), std::uint32_t, std::uint64_t>::type;
+
+//member functions
+    /// rank that the accumulated count must pass to reach a percentile
+    static unsigned long PercentileRank(const unsigned long num_items, const double percentile)
+    {
+        assert(percentile >= 0.0 && percentile <= 100.0);
+
+        if (num_items == 0)
+            return 0;
+
+        unsigned long rank{static_cast<unsigned long>(static_cast<double>(num_items)*percentile/100.0)};
+
+        // the 100th percentile is the highest item
+        return rank < num_items ? rank : num_items - 1;
+    }
+
+    /// run an extraction kernel over all elements, split into ranges of whole blocks (one range per thread)
+    template <typename KernelT>
+    void ExtractInParallel(const KernelT &kernel) const
+    {
+        const std::size_t num_elements{NumElements()};
+        const std::size_t num_blocks{(num_elements + s_extraction_block - 1)/s_extraction_block};
+        const std::size_t num_threads{std::min(static_cast<std::size_t>(m_extraction_threads), num_blocks)};
+
+        if (num_threads <= 1)
+        {
+            kernel(0, num_elements);
+
+            return;
+        }
+
+        std::vector<std::thread> workers{};
+        workers.reserve(num_threads - 1);
+
+        const std::size_t blocks_per_thread{num_blocks/num_threads};
+        const std::size_t remainder_blocks{num_blocks%num_threads};
+        std::size_t range_begin{0};
+
+        for (std::size_t thread_index{0}; thread_index < num_threads; thread_index++)
+        {
+            const std::size_t range_blocks{blocks_per_thread + (thread_index < remainder_blocks ? 1 : 0)};
+            const std::size_t range_end{std::min(range_begin + range_blocks*s_extraction_block, num_elements)};
+
+            // the last range runs in this thread
+            if (thread_index + 1 == num_threads)
+                kernel(range_begin, range_end);
+            else
+                workers.emplace_back(kernel, range_begin, range_end);
+
+            range_begin = range_end;
+        }
+
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    /// extract a statistic for elements [begin, end) (output[i] is for element begin + i)
+    void StatisticKernel(const HistogramStatistic &statistic, unsigned char *output, const std::size_t begin, const std::size_t end) const
+    {
+        switch (statistic.type)
+        {
+            case HistogramStatType::PERCENTILE :
+                PercentileKernel(statistic.parameter, output, begin, end);
+                break;
+
+            case HistogramStatType::MODE :
+                ModeKernel(output, begin, end);
+                break;
+
+            case HistogramStatType::TRIMMED_MEAN :
+                TrimmedMeanKernel(statistic.parameter, output, begin, end);
+                break;
+
+            case HistogramStatType::INTERQUARTILE_RANGE :
+                InterquartileRangeKernel(output, begin, end);
+                break;
+
+            case HistogramStatType::MEDIAN_ABSOLUTE_DEVIATION :
+                MedianAbsoluteDeviationKernel(output, begin, end);
+                break;
+
+            default :
+                assert(false);
+        };
+    }
+
+    /// sum the histograms of a block of elements
+    void BinTotals(const std::size_t block_begin, const std::size_t block_size, accumulator_type *totals) const
+    {
+        for (std::size_t i{0}; i < block_size; i++)
+            totals[i] = 0;
+
+        // each bin's counts for the block are contiguous, so the inner loop can be vectorized
+        for (std::size_t histogram_index{0}; histogram_index < s_num_bins; histogram_index++)
+        {
+            const T *bins{m_histograms[histogram_index].data() + block_begin};
+
+            for (std::size_t i{0}; i < block_size; i++)
+                totals[i] += bins[i];
+        }
+    }
+
+    /// percentile (0 - 100) of elements [begin, end)
+    void PercentileKernel(const double percentile, unsigned char *output, const std::size_t begin, const std::size_t end) const
+    {
+        accumulator_type totals[s_extraction_block];
+        accumulator_type ranks[s_extraction_block];
+        accumulator_type accumulators[s_extraction_block];
+        std::uint32_t bins_below_rank[s_extraction_block];
+
+        for (std::size_t block_begin{begin}; block_begin < end; block_begin += s_extraction_block)
+        {
+            const std::size_t block_size{std::min(s_extraction_block, end - block_begin)};
+
+            // count items actually in the histograms (bins may have saturated or been halved)
+            BinTotals(block_begin, block_size, totals);
+
+            for (std::size_t i{0}; i < block_size; i++)
+            {
+                ranks[i] = static_cast<accumulator_type>(PercentileRank(totals[i], percentile));
+                accumulators[i] = 0;
+                bins_below_rank[i] = 0;
+            }
+
+            // the percentile's histogram index is the number of bins before the accumulated count passes the rank
+            for (std::size_t histogram_index{0}; histogram_index < s_num_bins; histogram_index++)
+            {
+                const T *bins{m_histograms[histogram_index].data() + block_begin};
+                std::size_t num_passed{0};
+
+                for (std::size_t i{0}; i < block_size; i++)
+                {
+                    accumulators[i] += bins[i];
+                    bins_below_rank[i] += (accumulators[i] <= ranks[i]);
+                    num_passed += (accumulators[i] > ranks[i]);
+                }
+
+                // leave early once every element in the block has found its percentile
+                if (num_passed == block_size)
+                    break;
+            }
+
+            for (std::size_t i{0}; i < block_size; i++)
+            {
+                output[block_begin - begin + i] = static_cast<unsigned char>(
+                        bins_below_rank[i] < s_num_bins ? bins_below_rank[i] : s_num_bins - 1
+                    );
+            }
+        }
+    }
+
+    /// mode (most frequent value; lowest value wins ties) of elements [begin, end)
+    void ModeKernel(unsigned char *output, const std::size_t begin, const std::size_t end) const
+    {
+        T highest_counts[s_extraction_block];
+        std::uint32_t modes[s_extraction_block];
+
+        for (std::size_t block_begin{begin}; block_begin < end; block_begin += s_extraction_block)
+        {
+            const std::size_t block_size{std::min(s_extraction_block, end - block_begin)};
+
+            for (std::size_t i{0}; i < block_size; i++)
+            {
+                highest_counts[i] = 0;
+                modes[i] = 0;
+            }
+
+            for (std::size_t histogram_index{0}; histogram_index < s_num_bins; histogram_index++)
+            {
+                const T *bins{m_histograms[histogram_index].data() + block_begin};
+
+                for (std::size_t i{0}; i < block_size; i++)
+                {
+                    const bool is_higher{bins[i] > highest_counts[i]};
+                    highest_counts[i] = is_higher ? bins[i] : highest_counts[i];
+                    modes[i] = is_higher ? static_cast<std::uint32_t>(histogram_index) : modes[i];
+                }
+            }
+
+            for (std::size_t i{0}; i < block_size; i++)
+                output[block_begin - begin + i] = static_cast<unsigned char>(modes[i]);
+        }
+    }
+
+    /// trimmed mean (trim_percent of the items are discarded from each tail, 0 <= trim_percent < 50) of elements [begin, end)
+    void TrimmedMeanKernel(const double trim_percent, unsigned char *output, const std::size_t begin, const std::size_t end) const
+    {
+        accumulator_type totals[s_extraction_block];
+        accumulator_type rank_begins[s_extraction_block];
+        accumulator_type rank_ends[s_extraction_block];
+        accumulator_type accumulators[s_extraction_block];
+        std::uint64_t value_sums[s_extraction_block];
+
+        for (std::size_t block_begin{begin}; block_begin < end; block_begin += s_extraction_block)
+        {
+            const std::size_t block_size{std::min(s_extraction_block, end - block_begin)};
+
+            // count items actually in the histograms (bins may have saturated or been halved)
+            BinTotals(block_begin, block_size, totals);
+
+            for (std::size_t i{0}; i < block_size; i++)
+            {
+                // ranks [rank_begin, rank_end) survive trimming (always keep at least one item)
+                accumulator_type num_trimmed{static_cast<accumulator_type>(static_cast<double>(totals[i])*trim_percent/100.0)};
+                rank_begins[i] = num_trimmed;
+                rank_ends[i] = totals[i] - num_trimmed;
+
+                if (rank_ends[i] <= rank_begins[i])
+                {
+                    rank_begins[i] = totals[i] ? (totals[i] - 1)/2 : 0;
+                    rank_ends[i] = rank_begins[i] + 1;
+                }
+
+                accumulators[i] = 0;
+                value_sums[i] = 0;
+            }
+
+            // add up the values whose ranks survived
+            for (std::size_t histogram_index{0}; histogram_index < s_num_bins; histogram_index++)
+            {
+                const T *bins{m_histograms[histogram_index].data() + block_begin};
+                std::size_t num_finished{0};
+
+                for (std::size_t i{0}; i < block_size; i++)
+                {
+                    const accumulator_type bin_begin{accumulators[i]};
+                    accumulators[i] += bins[i];
+
+                    const accumulator_type overlap_begin{bin_begin > rank_begins[i] ? bin_begin : rank_begins[i]};
+                    const accumulator_type overlap_end{accumulators[i] < rank_ends[i] ? accumulators[i] : rank_ends[i]};
+                    const accumulator_type overlap{overlap_end > overlap_begin ? overlap_end - overlap_begin : 0};
+
+                    value_sums[i] += static_cast<std::uint64_t>(histogram_index)*overlap;
+                    num_finished += (accumulators[i] >= rank_ends[i]);
+                }
+
+                // leave early once every element in the block has passed its surviving ranks
+                if (num_finished == block_size)
+                    break;
+            }
+
+            // round to nearest value (an empty histogram has no surviving items)
+            for (std::size_t i{0}; i < block_size; i++)
+            {
+                const std::uint64_t value_count{totals[i] ? static_cast<std::uint64_t>(rank_ends[i] - rank_begins[i]) : 0};
+
+                output[block_begin - begin + i] = value_count ?
+                    static_cast<unsigned char>((value_sums[i] + value_count/2)/value_count) :
+                    static_cast<unsigned char>(0);
+            }
+        }
+    }
+
+    /// interquartile range (75th percentile - 25th percentile) of elements [begin, end)
+    void InterquartileRangeKernel(unsigned char *output, const std::size_t begin, const std::size_t end) const
+    {
+        std::vector<unsigned char> first_quartile(end - begin);
+
+        PercentileKernel(25.0, first_quartile.data(), begin, end);
+        PercentileKernel(75.0, output, begin, end);
+
+        for (std::size_t i{0}; i < first_quartile.size(); i++)
+            output[i] -= first_quartile[i];
+    }
+
+    /// median absolute deviation (median of |value - median|) of elements [begin, end)
+    void MedianAbsoluteDeviationKernel(unsigned char *output, const std::size_t begin, const std::size_t end) const
+    {
+        accumulator_type totals[s_extraction_block];
+        accumulator_type ranks[s_extraction_block];
+        accumulator_type accumulators[s_extraction_block];
+        std::uint32_t deviations[s_extraction_block];
+
+        // medians first
+        PercentileKernel(50.0, output, begin, end);
+
+        for (std::size_t block_begin{begin}; block_begin < end; block_begin += s_extraction_block)
+        {
+            const std::size_t block_size{std::min(s_extraction_block, end - block_begin)};
+            const unsigned char *medians{output + (block_begin - begin)};
+
+            BinTotals(block_begin, block_size, totals);
+
+            for (std::size_t i{0}; i < block_size; i++)
+            {
+                ranks[i] = static_cast<accumulator_type>(PercentileRank(totals[i], 50.0));
+                accumulators[i] = 0;
+                deviations[i] = 0;
+            }
+
+            // the deviations form a histogram folded over the median: deviation d counts bins (median - d) and (median + d)
+            for (int deviation{0}; deviation < static_cast<int>(s_num_bins); deviation++)
+            {
+                std::size_t num_passed{0};
+
+                for (std::size_t i{0}; i < block_size; i++)
+                {
+                    const int median{medians[i]};
+                    const std::size_t element_index{block_begin + i};
+
+                    if (median - deviation >= 0)
+                        accumulators[i] += m_histograms[median - deviation][element_index];
+
+                    if (deviation > 0 && median + deviation < static_cast<int>(s_num_bins))
+                        accumulators[i] += m_histograms[median + deviation][element_index];
+
+                    deviations[i] += (accumulators[i] <= ranks[i]);
+                    num_passed += (accumulators[i] > ranks[i]);
+                }
+
+                if (num_passed == block_size)
+                    break;
+            }
+
+            // write after the block is done, since the medians share the output
+            for (std::size_t i{0}; i < block_size; i++)
+            {
+                output[block_begin - begin + i] = static_cast<unsigned char>(
+                        deviations[i] < s_num_bins ? deviations[i] : s_num_bins - 1
+                    );
+            }
+        }
+    }
+
+    /// halve the counts in one element's histogram (non-zero counts stay non-zero)
+    void HalveElement(const std::size_t element_index)
+    {
+        for (auto &bins : m_histograms)
+            bins[element_index] = static_cast<T>(bins[element_index]/2 + bins[element_index]%2);
+    }
+
+    /// add another set of histograms' counts, saturating bins that would roll over
+    void MergeWithSaturation(const ElementHistograms &other)
+    {
+        for (std::size_t histogram_index{0}; histogram_index < m_histograms.size(); histogram_index++)
+        {
+            std::vector<T> &bins{m_histograms[histogram_index]};
+            const std::vector<T> &other_bins{other.m_histograms[histogram_index]};
+
+            for (std::size_t element_index{0}; element_index < bins.size(); element_index++)
+            {
+                // saturate instead of rolling over
+                if (bins[element_index] > static_cast<T>(-1) - other_bins[element_index])
+                    bins[element_index] = static_cast<T>(-1);
+                else
+                    bins[element_index] += other_bins[element_index];
+            }
+        }
+    }
+
+    /// add another set of histograms' counts, halving an element's combined histogram until it fits
+    void MergeWithHalving(const ElementHistograms &other)
+    {
+        // elements are rare to overflow, so find the largest combined bin first and only rescale when needed
+        std::vector<unsigned long> largest_sums(NumElements(), 0);
+
+        for (std::size_t histogram_index{0}; histogram_index < m_histograms.size(); histogram_index++)
+        {
+            const std::vector<T> &bins{m_histograms[histogram_index]};
+            const std::vector<T> &other_bins{other.m_histograms[histogram_index]};
+
+            for (std::size_t element_index{0}; element_index < bins.size(); element_index++)
+            {
+                unsigned long sum{static_cast<unsigned long>(bins[element_index]) + other_bins[element_index]};
+
+                if (sum > largest_sums[element_index])
+                    largest_sums[element_index] = sum;
+            }
+        }
+
+        // number of halvings each element needs
+        std::vector<unsigned char> shifts(NumElements(), 0);
+
+        for (std::size_t element_index{0}; element_index < shifts.size(); element_index++)
+        {
+            while ((largest_sums[element_index] >> shifts[element_index]) > static_cast<unsigned long>(static_cast<T>(-1)))
+                shifts[element_index]++;
+        }
+
+        for (std::size_t histogram_index{0}; histogram_index < m_histograms.size(); histogram_index++)
+        {
+            std::vector<T> &bins{m_histograms[histogram_index]};
+            const std::vector<T> &other_bins{other.m_histograms[histogram_index]};
+
+            for (std::size_t element_index{0}; element_index < bins.size(); element_index++)
+            {
+                unsigned long sum{static_cast<unsigned long>(bins[element_index]) + other_bins[element_index]};
+                unsigned long shifted{sum >> shifts[element_index]};
+
+                // non-zero counts stay non-zero
+                if (shifted == 0 && sum > 0)
+                    shifted = 1;
+
+                bins[element_index] = static_cast<T>(shifted);
+            }
+        }
+    }
+
+    /// allocate zeroed histograms
+    void Initialize(const std::size_t num_elements)
+    {
+        assert(num_elements > 0);
+
+        std::size_t max_uchar{static_cast<unsigned char>(-1)};
+        m_histograms.clear();
+        m_histograms.resize(max_uchar + 1, std::vector<T>(num_elements, T{0}));
+
+        // check that it worked
+        assert(m_histograms[0].size() == num_elements);
+    }
+
+//member variables
+    /// number of histogram bins per element (one per unsigned char value)
+    static constexpr std::size_t s_num_bins{256};
+    /// number of elements extracted together (their counts are contiguous in each bin, so each bin is one vectorizable sweep)
+    static constexpr std::size_t s_extraction_block{64};
+
+    /// number of threads that may be used to extract statistics
+    int m_extraction_threads{1};
+
+    /// what to do when a bin is full
+    HistogramOverflow m_overflow_policy{HistogramOverflow::SATURATE};
+
+    /// number of pixel rows in frame Mat
+    int m_frame_rows_count{0};
+    /// number of channels in each frame Mat
+    int m_frame_channel_count{0};
+
+    /// number of frames counted
+    long long m_frames_counted{0};
+
+    /// histograms for each image element; parent vector is histogram bins, child vector is all image elements
+    std::vector<std::vector<T>> m_histograms{};
+};
+
+/// static member definitions (needed when odr-used before C++17)
+template <typename T>
+constexpr std::size_t ElementHistograms<T>::s_num_bins;
+template <typename T>
+constexpr std::size_t ElementHistograms<T>::s_extraction_block;
+
+
+#endif //header guard
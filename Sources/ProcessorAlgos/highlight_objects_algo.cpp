@@ -25,9 +25,19 @@ void HighlightObjectsAlgo::HighlightObjects(cv::Mat &frame)
 
     //im_diff = cv2.absdiff(bkgd, frame)
     cv::Mat im_diff{cv::Size{frame.cols, frame.rows}, CV_16S}; //frame.type()};
-    im_diff = m_pack.background - frame;
-    im_diff.convertTo(im_diff, CV_8U);
-    // cv::absdiff(m_pack.background, frame, im_diff);
+    if (m_pack.frames_are_bg_diffs)
+        im_diff = frame;    //no copy: the frame is overwritten with the final image at the end
+    else
+    {
+        im_diff = m_pack.background - frame;
+        im_diff.convertTo(im_diff, CV_8U);
+        // cv::absdiff(m_pack.background, frame, im_diff);
+    }
+
+    // per-pixel threshold mode: discount each pixel's expected noise so the global thresholds apply on top of it
+    // (saturates at 0)
+    if (!m_noise_offset.empty())
+        cv::subtract(im_diff, m_noise_offset, im_diff);
 
     ///////////////////// THRESHOLD AND HIGH MIN SIZE /////////////////////
     // thresholds image to become black-and-white
@@ -189,25 +199,54 @@ void HighlightObjectsAlgo::FillHoles(cv::Mat &image)
         Based on:
          https://learnopencv.com/filling-holes-in-an-image-using-opencv-python-c/
     */
+    // tiles: a region touching a seam with another tile may connect to the background past the seam, so it is not a
+    //  hole; pad the seams with background to fill from (the tile's edges on the frame's border are handled as in whole
+    //  frames)
+    cv::Point frame_offset{0, 0};
+    cv::Size frame_size{image.cols, image.rows};
+    int pad_top{0};
+    int pad_bottom{0};
+    int pad_left{0};
+    int pad_right{0};
+
+    if (m_pack.frames_are_tiles)
+    {
+        frame_offset = m_pack.tile_region.tl();
+        frame_size = m_pack.frame_size;
+        pad_top = m_pack.tile_region.y > 0 ? 1 : 0;
+        pad_bottom = m_pack.tile_region.y + m_pack.tile_region.height < frame_size.height ? 1 : 0;
+        pad_left = m_pack.tile_region.x > 0 ? 1 : 0;
+        pad_right = m_pack.tile_region.x + m_pack.tile_region.width < frame_size.width ? 1 : 0;
+    }
+
     // formats image for OpenCV
     //im_floodfill = cvify(im_bw)
-    cv::Mat im_floodfill{image.clone()};
+    cv::Mat im_floodfill{};
+    cv::copyMakeBorder(image, im_floodfill, pad_top, pad_bottom, pad_left, pad_right, cv::BorderTypes::BORDER_CONSTANT, cv::Scalar{0});
 
     // fills bkgd with white (assuming origin is contiguously connected with bkgd)
     //cv2.floodFill(im_floodfill, None, (0,0), 255)
     // (ignores return val)
     // bug fix: previously filled obj instead of bkgd if object included seed pt (0,0)
     // now if object includes (0,0), switches seed pt to opposite corner of image
-    uint8_t* pixelPtr = (uint8_t*)im_floodfill.data;
+    // - seed pts are in frame coords (a tile without the frame's origin assumes the origin is bkgd; the origin's value
+    //   is only known after thresholding the tile that holds it, so when it is an object the other tiles differ from a
+    //   whole frame, see VidObjectTrackPack::tile_frames)
     cv::Point pt;
-    if (pixelPtr[0] == 255) {
+    if (frame_offset == cv::Point{0, 0} && image.at<uint8_t>(0, 0) == 255) {
         pt = cv::Point{0,0};
     } else {
-        int n_rows = im_floodfill.rows;
-        int n_cols = im_floodfill.cols;
-        pt = cv::Point{n_cols-1, n_rows-1}; // cv::Point takes (x,y) coords = (col, row)
+        pt = cv::Point{frame_size.width-1, frame_size.height-1}; // cv::Point takes (x,y) coords = (col, row)
     }
-    cv::floodFill(im_floodfill, pt, cv::Scalar{255});
+    pt -= frame_offset;
+    if (pt.x >= 0 && pt.y >= 0 && pt.x < image.cols && pt.y < image.rows)
+        cv::floodFill(im_floodfill, pt + cv::Point{pad_left, pad_top}, cv::Scalar{255});
+
+    // fills bkgd connected to the seams (the top/left and bottom/right padding each meet at a corner)
+    if (pad_top || pad_left)
+        cv::floodFill(im_floodfill, cv::Point{0, 0}, cv::Scalar{255});
+    if (pad_bottom || pad_right)
+        cv::floodFill(im_floodfill, cv::Point{im_floodfill.cols - 1, im_floodfill.rows - 1}, cv::Scalar{255});
 
     // inverts image (black -> white and white -> black)
     //im_inv = cv2.bitwise_not(im_floodfill)
@@ -215,7 +254,7 @@ void HighlightObjectsAlgo::FillHoles(cv::Mat &image)
 
     // combines inverted image with original image to fill holes
     //im_filled = (im_inv | im_bw)
-    cv::bitwise_or(image, im_floodfill, image);
+    cv::bitwise_or(image, im_floodfill(cv::Rect{pad_left, pad_top, image.cols, image.rows}), image);
 
     // return by reference
 }
@@ -29,6 +29,20 @@ struct TokenProcessorPack<HighlightObjectsAlgo> final
     const int min_size_hyst{};
     const int min_size_threshold{};
     const int width_border{};
+    /// optional per-pixel noise image (e.g. 'iqr' or 'mad' from the background pass), same size/channels as the background
+    /// - when set, each pixel's thresholds are raised by noise_scale*noise (per-pixel threshold mode)
+    cv::Mat noise{};
+    const double noise_scale{1.0};
+    /// if frames arrive already subtracted from the background (set internally, e.g. for rolling backgrounds)
+    bool frames_are_bg_diffs{false};
+    /// if frames are tiles cut from larger frames (set internally, e.g. for tiled highlighting)
+    /// - a hole is only filled if it doesn't touch a seam with another tile, since the region past the seam may open it up
+    /// - the tile's edges on the frame's border are treated as in whole frames
+    bool frames_are_tiles{false};
+    /// with frames_are_tiles: where the tile (including its overlap) sits in the frame
+    cv::Rect tile_region{};
+    /// with frames_are_tiles: size of the whole frame
+    cv::Size frame_size{};
 };
 
 ////
@@ -43,7 +57,11 @@ public:
 
     /// normal constructor
     HighlightObjectsAlgo(TokenProcessorPack<HighlightObjectsAlgo> processor_pack) : TokenProcessorAlgo{std::move(processor_pack)}
-    {}
+    {
+        // the per-pixel threshold offsets only need to be computed once
+        if (m_pack.noise.data && !m_pack.noise.empty() && m_pack.noise_scale > 0.0)
+            m_pack.noise.convertTo(m_noise_offset, CV_8U, m_pack.noise_scale);
+    }
 
     /// copy constructor: disabled
     HighlightObjectsAlgo(const HighlightObjectsAlgo&) = delete;
@@ -111,6 +129,8 @@ public:
 
 private:
 //member variables
+    /// amount to raise each pixel's thresholds by (empty if not using per-pixel thresholds)
+    cv::Mat m_noise_offset{};
     /// store result in anticipation of future requests
     std::unique_ptr<cv::Mat> m_result{};
 };
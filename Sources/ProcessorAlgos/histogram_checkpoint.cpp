@@ -0,0 +1,39 @@
+// saves/loads element-wise histograms to/from memory-mapped checkpoint files
+
+//local headers
+#include "histogram_checkpoint.h"
+
+//third party headers
+
+//standard headers
+#include <cstring>
+#include <string>
+
+
+HistogramCheckpointHeader ReadHistogramCheckpointHeader(const std::string &path)
+{
+    MappedFile file{path};
+    EXCEPTION_ASSERT_MSG(file.Size() >= sizeof(HistogramCheckpointHeader), "file is too small to be a histogram checkpoint: " + path);
+
+    HistogramCheckpointHeader header{};
+    std::memcpy(&header, file.Data(), sizeof(HistogramCheckpointHeader));
+
+    EXCEPTION_ASSERT_MSG(std::memcmp(header.magic, "CVVPHIST", sizeof(header.magic)) == 0, "not a histogram checkpoint: " + path);
+    EXCEPTION_ASSERT_MSG(header.version == 1, "unsupported histogram checkpoint version: " + path);
+    EXCEPTION_ASSERT_MSG(header.bin_bytes == 1 || header.bin_bytes == 2 || header.bin_bytes == 4 || header.bin_bytes == 8,
+        "invalid histogram checkpoint bin size: " + path);
+    EXCEPTION_ASSERT_MSG(header.rows > 0 && header.cols > 0 && header.channels > 0 && header.frames_counted > 0,
+        "invalid histogram checkpoint dimensions: " + path);
+
+    // the counts must all be there
+    EXCEPTION_ASSERT_MSG(file.Size() == sizeof(HistogramCheckpointHeader) +
+            histogram_checkpoint_bins*HistogramCheckpointElements(header)*header.bin_bytes,
+        "histogram checkpoint is truncated: " + path);
+
+    return header;
+}
+
+std::size_t HistogramCheckpointElements(const HistogramCheckpointHeader &header)
+{
+    return static_cast<std::size_t>(header.rows)*static_cast<std::size_t>(header.cols)*static_cast<std::size_t>(header.channels);
+}
@@ -0,0 +1,197 @@
+// saves/loads element-wise histograms to/from memory-mapped checkpoint files
+//
+// file layout (host byte order):
+//   [HistogramCheckpointHeader: 64 bytes]
+//   [256 bins x num_elements counts, bin-major (all elements' counts for bin 0, then bin 1, ...), bin_bytes each]
+// - num_elements = rows x cols x channels, in cv::Mat element order
+// - checkpoints of the same region can be merged (summed), so a video can be split between processes,
+//   and a crashed job only needs to redo the frame ranges that have no checkpoint
+
+#ifndef HISTOGRAM_CHECKPOINT_3309815_H
+#define HISTOGRAM_CHECKPOINT_3309815_H
+
+//local headers
+#include "element_histograms.h"
+#include "exception_assert.h"
+#include "mapped_file.h"
+
+//third party headers
+
+//standard headers
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+/// fixed-size header at the start of every checkpoint file
+struct HistogramCheckpointHeader final
+{
+    /// always 'CVVPHIST'
+    char magic[8];
+    /// file format version (currently 1)
+    std::uint32_t version;
+    /// bytes per histogram count (1, 2, 4, or 8)
+    std::uint32_t bin_bytes;
+    /// frame dimensions
+    std::int32_t rows;
+    std::int32_t cols;
+    std::int32_t channels;
+    /// HistogramOverflow the counts were collected with (0 = SATURATE, 1 = HALVE)
+    std::uint32_t overflow_policy;
+    /// first frame of the range the histograms were collected from
+    std::int64_t start_frame;
+    /// lowest frame index after the range
+    std::int64_t end_frame;
+    /// number of frames counted by the histograms
+    std::int64_t frames_counted;
+    /// reserved (zero)
+    std::uint8_t reserved[8];
+};
+
+static_assert(sizeof(HistogramCheckpointHeader) == 64, "histogram checkpoint header must be 64 bytes");
+
+/// number of histogram bins per element in a checkpoint
+constexpr std::size_t histogram_checkpoint_bins{256};
+
+/// read and validate the header of a checkpoint file
+HistogramCheckpointHeader ReadHistogramCheckpointHeader(const std::string &path);
+
+/// number of histogram elements in a checkpoint (rows x cols x channels)
+std::size_t HistogramCheckpointElements(const HistogramCheckpointHeader &header);
+
+/// write histograms to a checkpoint file (overwrites the file)
+template <typename T>
+void SaveHistogramCheckpoint(const ElementHistograms<T> &histograms,
+    const long long start_frame,
+    const long long end_frame,
+    const std::string &path)
+{
+    EXCEPTION_ASSERT_MSG(histograms.FramesCounted() > 0, "can't checkpoint empty histograms");
+
+    const std::size_t num_elements{histograms.NumElements()};
+    const std::size_t bin_bytes{num_elements*sizeof(T)};
+
+    HistogramCheckpointHeader header{};
+    std::memcpy(header.magic, "CVVPHIST", sizeof(header.magic));
+    header.version = 1;
+    header.bin_bytes = static_cast<std::uint32_t>(sizeof(T));
+    header.rows = histograms.FrameRows();
+    header.cols = static_cast<std::int32_t>(num_elements / static_cast<std::size_t>(histograms.FrameRows()*histograms.FrameChannels()));
+    header.channels = histograms.FrameChannels();
+    header.overflow_policy = histograms.OverflowPolicy() == HistogramOverflow::HALVE ? 1 : 0;
+    header.start_frame = start_frame;
+    header.end_frame = end_frame;
+    header.frames_counted = histograms.FramesCounted();
+
+    MappedFile file{path, sizeof(HistogramCheckpointHeader) + histogram_checkpoint_bins*bin_bytes};
+    unsigned char *data{file.MutableData()};
+
+    std::memcpy(data, &header, sizeof(HistogramCheckpointHeader));
+    data += sizeof(HistogramCheckpointHeader);
+
+    for (std::size_t bin{0}; bin < histogram_checkpoint_bins; bin++)
+        std::memcpy(data + bin*bin_bytes, histograms.BinCounts(bin), bin_bytes);
+
+    file.Flush();
+}
+
+/// read histograms from a checkpoint file, converting its counts to type T
+/// - an element whose counts don't fit in T has its whole histogram halved until they do, keeping its relative counts
+///   (as with HistogramOverflow::HALVE; pick T from the header's frames_counted to keep the exact counts)
+template <typename T>
+ElementHistograms<T> LoadHistogramCheckpoint(const std::string &path)
+{
+    const HistogramCheckpointHeader header{ReadHistogramCheckpointHeader(path)};
+    const std::size_t num_elements{HistogramCheckpointElements(header)};
+
+    ElementHistograms<T> histograms{header.overflow_policy == 1 ? HistogramOverflow::HALVE : HistogramOverflow::SATURATE};
+    histograms.Restore(header.rows, header.channels, num_elements, header.frames_counted);
+
+    MappedFile file{path};
+    const unsigned char *data{file.Data() + sizeof(HistogramCheckpointHeader)};
+
+    // copy the counts of each bin, converting them to T
+    auto load_counts = [&](auto count_type_tag)
+    {
+        using count_type = decltype(count_type_tag);
+        const std::uintmax_t max_count{std::numeric_limits<T>::max()};
+
+        auto read_count = [&](const std::size_t bin, const std::size_t element_index) -> std::uintmax_t
+        {
+            count_type count;
+            std::memcpy(&count, data + (bin*num_elements + element_index)*sizeof(count_type), sizeof(count_type));
+
+            return count;
+        };
+
+        if (sizeof(count_type) <= sizeof(T))
+        {
+            for (std::size_t bin{0}; bin < histogram_checkpoint_bins; bin++)
+            {
+                T *counts{histograms.MutableBinCounts(bin)};
+
+                if (std::is_same<count_type, T>::value)
+                {
+                    std::memcpy(counts, data + bin*num_elements*sizeof(T), num_elements*sizeof(T));
+                    continue;
+                }
+
+                for (std::size_t element_index{0}; element_index < num_elements; element_index++)
+                    counts[element_index] = static_cast<T>(read_count(bin, element_index));
+            }
+
+            return;
+        }
+
+        // number of halvings each element needs for its largest bin to fit in T
+        std::vector<count_type> largest_counts(num_elements, 0);
+
+        for (std::size_t bin{0}; bin < histogram_checkpoint_bins; bin++)
+        {
+            for (std::size_t element_index{0}; element_index < num_elements; element_index++)
+                largest_counts[element_index] = std::max(largest_counts[element_index], static_cast<count_type>(read_count(bin, element_index)));
+        }
+
+        std::vector<unsigned char> shifts(num_elements, 0);
+
+        for (std::size_t element_index{0}; element_index < num_elements; element_index++)
+        {
+            while ((static_cast<std::uintmax_t>(largest_counts[element_index]) >> shifts[element_index]) > max_count)
+                shifts[element_index]++;
+        }
+
+        for (std::size_t bin{0}; bin < histogram_checkpoint_bins; bin++)
+        {
+            T *counts{histograms.MutableBinCounts(bin)};
+
+            for (std::size_t element_index{0}; element_index < num_elements; element_index++)
+            {
+                const std::uintmax_t count{read_count(bin, element_index)};
+                std::uintmax_t shifted{count >> shifts[element_index]};
+
+                // non-zero counts stay non-zero
+                if (shifted == 0 && count > 0)
+                    shifted = 1;
+
+                counts[element_index] = static_cast<T>(shifted);
+            }
+        }
+    };
+
+    switch (header.bin_bytes)
+    {
+        case 1 : load_counts(std::uint8_t{}); break;
+        case 2 : load_counts(std::uint16_t{}); break;
+        case 4 : load_counts(std::uint32_t{}); break;
+        default : load_counts(std::uint64_t{}); break;
+    };
+
+    return histograms;
+}
+
+
+#endif //header guard
@@ -0,0 +1,170 @@
+// tracks whether the statistics of several histogram processing units have stopped changing
+
+#ifndef HISTOGRAM_CONVERGENCE_MONITOR_4410237_H
+#define HISTOGRAM_CONVERGENCE_MONITOR_4410237_H
+
+//local headers
+#include "element_histograms.h"
+
+//third party headers
+
+//standard headers
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+////
+// shared by all histogram processing units of one process (thread-safe)
+// - each unit periodically compares its running median to the previous one and reports if it has converged
+// - once every unit has converged, the callback is invoked (once), e.g. to stop the frame generator
+///
+class HistogramConvergenceMonitor final
+{
+public:
+//constructors
+    /// default constructor: disabled
+    HistogramConvergenceMonitor() = delete;
+
+    /// normal constructor
+    HistogramConvergenceMonitor(const int num_units,
+            const int check_interval,
+            const double tolerance,
+            std::function<void()> on_converged) :
+        m_num_units{num_units},
+        m_check_interval{check_interval},
+        m_tolerance{tolerance},
+        m_on_converged{std::move(on_converged)}
+    {}
+
+    /// copy constructor: disabled
+    HistogramConvergenceMonitor(const HistogramConvergenceMonitor&) = delete;
+
+//destructor: not needed (final class)
+
+//overloaded operators
+    /// copy assignment operator: disabled
+    HistogramConvergenceMonitor& operator=(const HistogramConvergenceMonitor&) = delete;
+
+//member functions
+    /// number of frames a unit should count between checks
+    int CheckInterval() const { return m_check_interval; }
+
+    /// check if a unit's statistic changed less than the tolerance (mean absolute change per element)
+    bool IsConverged(const std::vector<unsigned char> &previous, const std::vector<unsigned char> &current) const
+    {
+        if (previous.empty() || previous.size() != current.size())
+            return false;
+
+        unsigned long long total_change{0};
+
+        for (std::size_t element_index{0}; element_index < current.size(); element_index++)
+            total_change += static_cast<unsigned long long>(std::abs(static_cast<int>(current[element_index]) - previous[element_index]));
+
+        return static_cast<double>(total_change) <= m_tolerance*static_cast<double>(current.size());
+    }
+
+    /// a unit reports that it converged (true) or un-converged (false)
+    void ReportConvergence(const bool converged)
+    {
+        int units_converged{converged ? ++m_units_converged : --m_units_converged};
+
+        if (units_converged < m_num_units)
+            return;
+
+        // all units converged
+        std::call_once(m_converged_flag, [this]()
+            {
+                m_has_converged = true;
+
+                if (m_on_converged)
+                    m_on_converged();
+            });
+    }
+
+    /// check if all units converged at some point
+    bool HasConverged() const { return m_has_converged; }
+
+private:
+//member variables
+    /// number of units that must converge
+    const int m_num_units;
+    /// frames between checks
+    const int m_check_interval;
+    /// max mean absolute change per element for a unit to count as converged
+    const double m_tolerance;
+    /// called when all units have converged
+    std::function<void()> m_on_converged;
+
+    /// number of units currently converged
+    std::atomic<int> m_units_converged{0};
+    /// if all units have converged
+    std::atomic<bool> m_has_converged{false};
+    /// for invoking the callback once
+    std::once_flag m_converged_flag{};
+};
+
+////
+// one processing unit's view of a convergence monitor
+// - call Update() after each frame is added to the unit's histograms
+///
+class HistogramConvergenceProbe final
+{
+public:
+//constructors
+    /// default constructor: default (no monitor, never checks)
+    HistogramConvergenceProbe() = default;
+
+    /// normal constructor
+    HistogramConvergenceProbe(std::shared_ptr<HistogramConvergenceMonitor> monitor) : m_monitor{std::move(monitor)}
+    {}
+
+//member functions
+    /// check the unit's running median if it is time to
+    template <typename T>
+    void Update(const ElementHistograms<T> &histograms)
+    {
+        if (!m_monitor || m_monitor->CheckInterval() <= 0)
+            return;
+
+        if (histograms.FramesCounted() == 0 || histograms.FramesCounted() % m_monitor->CheckInterval() != 0)
+            return;
+
+        std::vector<unsigned char> median{histograms.MedianFromHistograms()};
+        bool converged{m_monitor->IsConverged(m_last_median, median)};
+
+        // only report changes
+        if (converged != m_converged)
+        {
+            m_converged = converged;
+            m_monitor->ReportConvergence(converged);
+        }
+
+        m_last_median = std::move(median);
+    }
+
+    /// forget the previous median (e.g. when the unit's histograms are reset)
+    void Reset()
+    {
+        if (m_monitor && m_converged)
+            m_monitor->ReportConvergence(false);
+
+        m_converged = false;
+        m_last_median.clear();
+    }
+
+private:
+//member variables
+    /// shared monitor
+    std::shared_ptr<HistogramConvergenceMonitor> m_monitor{};
+    /// median at the last check
+    std::vector<unsigned char> m_last_median{};
+    /// if the unit's median converged at the last check
+    bool m_converged{false};
+};
+
+
+#endif //header guard
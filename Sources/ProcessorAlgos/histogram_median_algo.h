@@ -1,10 +1,15 @@
 // computes element-wise median of cv::Mat sequence by collecting histograms for each element
 // - intended for computing the background image of a statically-positioned video recording
+// - other statistics (percentiles, mode, trimmed mean) can be extracted from the same histograms
 
 #ifndef HISTOGRAM_MEDIAN_ALGO_5776890_H
 #define HISTOGRAM_MEDIAN_ALGO_5776890_H
 
 //local headers
+#include "cv_util.h"
+#include "element_histograms.h"
+#include "histogram_convergence_monitor.h"
+#include "exception_assert.h"
 #include "token_processor_algo.h"
 
 //third party headers
@@ -31,7 +36,16 @@ using HistogramMedianAlgo32 = HistogramMedianAlgo<std::uint32_t>;   //4294967295
 
 template <typename T>
 struct TokenProcessorPack<HistogramMedianAlgo<T>> final
-{};
+{
+    /// statistics to extract from the histograms (empty means 'median only')
+    /// - if there are several, the result has their images stacked as channel groups in the same order
+    ///   (see cv_mats_to_channel_stack())
+    const std::vector<HistogramStatistic> statistics{};
+    /// what to do when a histogram bin is full (HALVE lets 8-bit histograms handle any number of frames)
+    const HistogramOverflow overflow_policy{HistogramOverflow::SATURATE};
+    /// optional monitor for stopping early once the running median stops changing (shared by all units)
+    const std::shared_ptr<HistogramConvergenceMonitor> convergence_monitor{};
+};
 
 ////
 // implementation for algorithm: histogram median
@@ -50,6 +64,9 @@ public:
         TokenProcessorAlgo<HistogramMedianAlgo<T>, cv::Mat, cv::Mat>{std::move(processor_pack)}
     {
         static_assert(std::is_unsigned<T>::value, "HistogramMedianAlgo only works with unsigned integrals for histogram elements!");
+
+        m_histograms = ElementHistograms<T>{this->m_pack.overflow_policy};
+        m_convergence_probe = HistogramConvergenceProbe{this->m_pack.convergence_monitor};
     }
 
     /// copy constructor: disabled
@@ -69,21 +86,11 @@ public:
         if (!new_mat || !new_mat->data || new_mat->empty())
             return;
 
-        // collect frame info from first frame
-        if (m_frames_processed == 0)
-        {
-            m_frame_rows_count = new_mat->rows;
-            m_frame_channel_count = new_mat->channels();
-        }
-
-        // convert frame to vector
-        std::vector<unsigned char> frame_as_vec{};
-        cv_mat_to_std_vector_uchar((*new_mat).clone(), frame_as_vec);
-
         // increment histograms
-        ConsumeVector(frame_as_vec);
+        m_histograms.ConsumeMat(*new_mat);
 
-        m_frames_processed++;
+        // check if the running median stopped changing
+        m_convergence_probe.Update(m_histograms);
     }
 
     /// get the processing result
@@ -102,8 +109,9 @@ public:
         // no more tokens, so set the result
         SetResult();
 
-        // reset number of frames processed
-        m_frames_processed = 0;
+        // reset histograms so the algo can be reused
+        m_histograms.Reset();
+        m_convergence_probe.Reset();
     }
 
     /// report if there is a result to get
@@ -112,111 +120,30 @@ public:
         return static_cast<bool>(m_result);
     }
 
-    /// increment histograms
-    void ConsumeVector(const std::vector<unsigned char> &new_elements)
+    void SetResult()
     {
-        // initialize histograms for first element
-        if (m_frames_processed == 0)
-        {
-            assert(new_elements.size() > 0);
+        // collect statistic images from histograms
+        std::vector<cv::Mat> images{m_histograms.Statistics(this->m_pack.statistics)};
 
-            std::vector<T> frequency_map{};
-            std::size_t max_uchar{static_cast<unsigned char>(-1)};
-            frequency_map.resize(new_elements.size(), T{0});
-            m_histograms.resize(max_uchar + 1, frequency_map);
-
-            // check that it worked
-            assert(m_histograms[0].size() == new_elements.size());
-        }
-
-        // increment all the histograms
-        for (std::size_t element_index{0}; element_index < m_histograms[0].size(); element_index++)
+        // no frames were collected
+        if (images.front().empty())
         {
-            // only increment histogram if it won't cause roll-over
-            if (m_histograms[static_cast<std::size_t>(new_elements[element_index])][element_index] != static_cast<T>(-1))
-            {
-                m_histograms[static_cast<std::size_t>(new_elements[element_index])][element_index]++;
-            }
-        }
-    }
+            m_result = std::make_unique<cv::Mat>();
 
-    /// collect median from histograms
-    std::vector<unsigned char> MedianFromHistograms()
-    {
-        assert(m_histograms.size() > 0);
-        assert(m_histograms[0].size() > 0);
-
-        std::vector<unsigned char> return_vec{};
-        return_vec.resize(m_histograms[0].size());
-        std::size_t max_uchar{static_cast<unsigned char>(-1)};
-        unsigned long accumulator_cap{static_cast<unsigned long>(m_frames_processed)};
-
-        for (std::size_t element_index{0}; element_index < m_histograms[0].size(); element_index++)
-        {
-            unsigned long accumulator{0};
-            std::size_t halfway_index{max_uchar};
-
-            // find the histogram index that sits in the middle of all items added
-            for (std::size_t histogram_index{0}; histogram_index < max_uchar + 1; histogram_index++)
-            {
-                accumulator += static_cast<unsigned long>(m_histograms[histogram_index][element_index]);
-
-                if ((halfway_index == max_uchar) && (accumulator > accumulator_cap/2))
-                    halfway_index = histogram_index;
-            }
-
-            // if a histogram index reached its limit, then maybe all items aren't accounted for, so backtrack
-            if (accumulator != accumulator_cap)
-            {
-                // set temp cap to actual number of items counted
-                unsigned long temp_cap{accumulator};
-
-                for (std::size_t histogram_index{halfway_index}; histogram_index != static_cast<std::size_t>(-1); histogram_index--)
-                {
-                    accumulator -= static_cast<unsigned long>(m_histograms[histogram_index][element_index]);
-
-                    // use the histogram index above the halfway mark
-                    if (accumulator < temp_cap/2)
-                        break;
-
-                    halfway_index--;
-                }
-            }
-
-            // sanity check
-            assert(halfway_index < max_uchar + 1);
-
-            return_vec[element_index] = static_cast<unsigned char>(halfway_index);
+            return;
         }
 
-        return return_vec;
-    }
-
-    void SetResult()
-    {
-        // collect histogram results
-        std::vector<unsigned char> result_vec{MedianFromHistograms()};
-
-        // convert vector to Mat image
-        cv::Mat result_frame{};
-        cv_mat_from_std_vector_uchar(result_frame, result_vec, m_frame_rows_count, m_frame_channel_count);
-
-        // set the result
-        m_result = std::make_unique<cv::Mat>(std::move(result_frame));
+        // combine the images so they can be reassembled as one image
+        m_result = std::make_unique<cv::Mat>();
+        EXCEPTION_ASSERT(cv_mats_to_channel_stack(images, *m_result));
     }
 
 private:
 //member variables
-    /// number of pixel rows in frame Mat
-    int m_frame_rows_count{0};
-    /// number of channels in each frame Mat
-    int m_frame_channel_count{0};
-
-    /// number of frames processed
-    int m_frames_processed{0};
-
-    /// histograms for processing median of each element; parent vector is all image elements, child vector is histogram
-    std::vector<std::vector<T>> m_histograms{};
+    /// histograms for processing median of each element
+    ElementHistograms<T> m_histograms{};
+    /// convergence checks for this unit
+    HistogramConvergenceProbe m_convergence_probe{};
     /// store result in anticipation of future requests
     std::unique_ptr<cv::Mat> m_result{};
 };
@@ -0,0 +1,127 @@
+// collects element-wise histograms of a subset of frames from a cv::Mat sequence
+// - the histograms from all shards are meant to be summed before extracting the median (see HistogramMergeConsumer)
+
+#ifndef HISTOGRAM_SHARD_ALGO_7765401_H
+#define HISTOGRAM_SHARD_ALGO_7765401_H
+
+//local headers
+#include "element_histograms.h"
+#include "histogram_convergence_monitor.h"
+#include "token_processor_algo.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+
+/// processor algorithm type declaration
+template <typename T>
+class HistogramShardAlgo;
+
+/// main types to use for interacting with the histogram shard algorithm
+/// - the histogram type must be large enough to hold the total number of frames across ALL shards (they are summed)
+/// - WARNING: each shard holds histograms for the full frame, so RAM cost is multiplied by the number of shards
+using HistogramShardAlgo8 = HistogramShardAlgo<unsigned char>;
+using HistogramShardAlgo16 = HistogramShardAlgo<std::uint16_t>;
+using HistogramShardAlgo32 = HistogramShardAlgo<std::uint32_t>;
+
+template <typename T>
+struct TokenProcessorPack<HistogramShardAlgo<T>> final
+{
+    /// what to do when a histogram bin is full (HALVE lets 8-bit histograms handle any number of frames)
+    const HistogramOverflow overflow_policy{HistogramOverflow::SATURATE};
+    /// optional monitor for stopping early once the running median stops changing (shared by all units)
+    const std::shared_ptr<HistogramConvergenceMonitor> convergence_monitor{};
+};
+
+////
+// implementation for algorithm: histogram shard
+// collects full cv::Mat frames and increments histograms for each element
+// the result is the histograms themselves, which are obtained after all tokens have been inserted
+///
+template <typename T>
+class HistogramShardAlgo final : public TokenProcessorAlgo<HistogramShardAlgo<T>, cv::Mat, ElementHistograms<T>>
+{
+public:
+//constructors
+    /// default constructor: disabled
+    HistogramShardAlgo() = delete;
+
+    /// normal constructor
+    HistogramShardAlgo(TokenProcessorPack<HistogramShardAlgo<T>> processor_pack) :
+        TokenProcessorAlgo<HistogramShardAlgo<T>, cv::Mat, ElementHistograms<T>>{std::move(processor_pack)}
+    {
+        static_assert(std::is_unsigned<T>::value, "HistogramShardAlgo only works with unsigned integrals for histogram elements!");
+
+        m_histograms = ElementHistograms<T>{this->m_pack.overflow_policy};
+        m_convergence_probe = HistogramConvergenceProbe{this->m_pack.convergence_monitor};
+    }
+
+    /// copy constructor: disabled
+    HistogramShardAlgo(const HistogramShardAlgo&) = delete;
+
+//destructor: not needed (final class)
+
+//overloaded operators
+    /// copy assignment operator: disabled
+    HistogramShardAlgo& operator=(const HistogramShardAlgo&) = delete;
+
+//member functions
+    /// insert an element to be processed
+    virtual void Insert(std::unique_ptr<cv::Mat> new_mat) override
+    {
+        // leave if reached the end of the video or frame is corrupted
+        if (!new_mat || !new_mat->data || new_mat->empty())
+            return;
+
+        // increment histograms
+        m_histograms.ConsumeMat(*new_mat);
+
+        // check if the running median stopped changing
+        m_convergence_probe.Update(m_histograms);
+    }
+
+    /// get the processing result
+    virtual std::unique_ptr<ElementHistograms<T>> TryGetResult() override
+    {
+        // get result if there is one
+        if (m_result)
+            return std::move(m_result);
+        else
+            return nullptr;
+    }
+
+    /// get notified there are no more elements
+    virtual void NotifyNoMoreTokens() override
+    {
+        // hand off the histograms (a shard that saw no frames has nothing to contribute)
+        if (m_histograms.FramesCounted() > 0)
+            m_result = std::make_unique<ElementHistograms<T>>(std::move(m_histograms));
+
+        // reset histograms so the algo can be reused
+        m_histograms.Reset();
+        m_convergence_probe.Reset();
+    }
+
+    /// report if there is a result to get
+    virtual bool HasResults() override
+    {
+        return static_cast<bool>(m_result);
+    }
+
+private:
+//member variables
+    /// histograms for the frames seen by this shard
+    ElementHistograms<T> m_histograms{};
+    /// convergence checks for this unit
+    HistogramConvergenceProbe m_convergence_probe{};
+    /// store result in anticipation of future requests
+    std::unique_ptr<ElementHistograms<T>> m_result{};
+};
+
+
+#endif //header guard
@@ -0,0 +1,109 @@
+// maintains the element-wise median of a sliding window of cv::Mat frames
+// - intended for tracking background drift (e.g. illumination changes) in long video recordings
+
+#ifndef ROLLING_BACKGROUND_8812034_H
+#define ROLLING_BACKGROUND_8812034_H
+
+//local headers
+#include "element_histograms.h"
+#include "exception_assert.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cstdint>
+#include <deque>
+
+
+////
+// sliding-window background
+// - every frame added is counted in element-wise histograms; once the window is full the oldest frame is removed
+// - the background is re-extracted from the histograms every 'update_interval' frames once the window is full
+// - until then the initial background is used
+// - WARNING: keeps 'window_size' frames in memory (plus 512 bytes of histograms per frame element)
+///
+class RollingBackground final
+{
+public:
+//constructors
+    /// default constructor: disabled
+    RollingBackground() = delete;
+
+    /// normal constructor
+    RollingBackground(const int window_size, const int update_interval, cv::Mat initial_background) :
+        m_window_size{window_size},
+        m_update_interval{update_interval > 0 ? update_interval : window_size},
+        m_background{std::move(initial_background)}
+    {
+        EXCEPTION_ASSERT(m_window_size > 0);
+        EXCEPTION_ASSERT(m_window_size <= static_cast<int>(static_cast<std::uint16_t>(-1)));
+    }
+
+    /// copy constructor: disabled
+    RollingBackground(const RollingBackground&) = delete;
+
+//destructor: not needed (final class)
+
+//overloaded operators
+    /// copy assignment operator: disabled
+    RollingBackground& operator=(const RollingBackground&) = delete;
+
+//member functions
+    /// add a frame to the window (the frame is stored, so it must not be modified afterward)
+    void AddFrame(const cv::Mat &frame)
+    {
+        if (!frame.data || frame.empty())
+            return;
+
+        m_histograms.ConsumeMat(frame);
+
+        // views into larger images (e.g. cropped frames) are copied so the larger image isn't kept alive
+        m_window.emplace_back(frame.isContinuous() ? frame : frame.clone());
+
+        // slide the window
+        if (static_cast<int>(m_window.size()) > m_window_size)
+        {
+            m_histograms.RemoveMat(m_window.front());
+            m_window.pop_front();
+        }
+
+        m_frames_since_update++;
+
+        // refresh the background
+        if (static_cast<int>(m_window.size()) == m_window_size && m_frames_since_update >= m_update_interval)
+        {
+            m_background = m_histograms.Median();
+            m_frames_since_update = 0;
+            m_num_updates++;
+        }
+    }
+
+    /// get the current background
+    const cv::Mat& Background() const { return m_background; }
+
+    /// number of times the background has been refreshed from the window
+    long long NumUpdates() const { return m_num_updates; }
+
+private:
+//member variables
+    /// number of frames in the window
+    const int m_window_size;
+    /// frames between background updates
+    const int m_update_interval;
+
+    /// histograms of the frames in the window
+    ElementHistograms<std::uint16_t> m_histograms{};
+    /// frames in the window (oldest first)
+    std::deque<cv::Mat> m_window{};
+    /// frames added since the last background update
+    int m_frames_since_update{0};
+    /// number of background updates
+    long long m_num_updates{0};
+
+    /// current background
+    cv::Mat m_background{};
+};
+
+
+#endif //header guard
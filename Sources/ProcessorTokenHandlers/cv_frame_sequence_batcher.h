@@ -0,0 +1,162 @@
+// batches frames read one at a time by frame number (shared by generators of sources with random access to their frames)
+
+#ifndef CV_FRAME_SEQUENCE_BATCHER_1840276_H
+#define CV_FRAME_SEQUENCE_BATCHER_1840276_H
+
+//local headers
+#include "cv_vid_frames_generator_algo.h"
+#include "exception_assert.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+////
+// turns frames read one at a time by frame number into token sets following the settings of a frame generator pack
+// - handles the frame range and requested frames (frame_indices), stop requests, near-duplicate accounting, and
+//   starting over after the last batch; the owning generator only reads frames (see GetTokenSet())
+// - the pack must outlive the batcher (it is normally the owning generator's pack)
+///
+class CvFrameSequenceBatcher final
+{
+public:
+//member types
+    using token_set_type = std::vector<std::unique_ptr<cv::Mat>>;
+
+//constructors
+    /// default constructor: disabled
+    CvFrameSequenceBatcher() = delete;
+
+    /// normal constructor
+    /// - 'num_frames': number of frames in the source (frame numbers at or past it end the frames)
+    /// - 'frames_are_borrowed': see CvFrameTokenizer
+    CvFrameSequenceBatcher(const TokenGeneratorPack<CvVidFramesGeneratorAlgo> &pack,
+            const long long num_frames,
+            const bool frames_are_borrowed) :
+        m_pack{pack},
+        m_num_frames{num_frames}
+    {
+        // sanity checks
+        EXCEPTION_ASSERT(m_pack.batch_size == m_pack.frames_in_batch*m_pack.chunks_per_frame);
+        EXCEPTION_ASSERT(m_pack.frames_in_batch > 0 && m_pack.chunks_per_frame > 0);
+        EXCEPTION_ASSERT(m_pack.start_frame >= 0);
+        EXCEPTION_ASSERT(m_pack.start_frame < m_num_frames);
+        EXCEPTION_ASSERT(m_pack.last_frame - m_pack.start_frame > 0);
+
+        for (std::size_t index{0}; index < m_pack.frame_indices.size(); index++)
+        {
+            EXCEPTION_ASSERT(m_pack.frame_indices[index] >= m_pack.start_frame && m_pack.frame_indices[index] < m_pack.last_frame);
+            EXCEPTION_ASSERT(index == 0 || m_pack.frame_indices[index] > m_pack.frame_indices[index - 1]);
+        }
+
+        // cropping, conversion, and chunking
+        m_tokenizer = std::make_unique<CvFrameTokenizer>(m_pack, false, frames_are_borrowed);
+    }
+
+    /// copy constructor: disabled
+    CvFrameSequenceBatcher(const CvFrameSequenceBatcher&) = delete;
+
+//overloaded operators
+    /// asignment operator: disabled
+    CvFrameSequenceBatcher& operator=(const CvFrameSequenceBatcher&) = delete;
+
+//member functions
+    /// get the next token set (batch of frames each chunked into segments)
+    /// - 'read_frame': callable that reads a frame by number, 'cv::Mat(long long frame_number)'; an empty frame ends the
+    ///   frames (the reader should report why)
+    /// - an empty token set means there were no frames left; the next call starts over from the start frame
+    template <typename ReadFrameT>
+    token_set_type GetTokenSet(ReadFrameT &&read_frame)
+    {
+        token_set_type return_token_set{};
+        std::size_t chunks_collected{0};
+
+        int frames_collected{0};
+
+        while (frames_collected < m_pack.frames_in_batch)
+        {
+            // leave if reached the last frame
+            long long frame_number{-1};
+
+            if (!GetFrameNumber(m_frames_consumed, frame_number))
+                break;
+
+            // leave if the owner wants no more frames
+            if (m_pack.control && m_pack.control->stop_requested)
+                break;
+
+            // get next frame from the source
+            cv::Mat frame{read_frame(frame_number)};
+
+            if (!frame.data || frame.empty())
+                break;
+
+            // we will get data, so prepare the return vector (first pass-through)
+            if (!return_token_set.size())
+                return_token_set.resize(m_pack.batch_size);
+
+            m_frames_consumed++;
+
+            // crop, convert, and chunk the frame (leave it out if it barely differs from the last emitted frame)
+            if (!m_tokenizer->TokenizeFrame(std::move(frame), return_token_set, chunks_collected))
+            {
+                if (m_pack.control)
+                    m_pack.control->frames_skipped++;
+
+                continue;
+            }
+
+            frames_collected++;
+
+            if (m_pack.control)
+                m_pack.control->frames_generated++;
+        }
+
+        // reset if failed to get any frames/frame chunks
+        if (!return_token_set.size())
+        {
+            m_frames_consumed = 0;
+            m_tokenizer->Reset();
+        }
+
+        return return_token_set;
+    }
+
+private:
+    /// get the frame number of the n-th frame to consume (returns false if there is none)
+    bool GetFrameNumber(const long long frames_consumed, long long &frame_output) const
+    {
+        if (frames_consumed >= m_pack.last_frame - m_pack.start_frame)
+            return false;
+
+        if (m_pack.frame_indices.size())
+        {
+            if (frames_consumed >= static_cast<long long>(m_pack.frame_indices.size()))
+                return false;
+
+            frame_output = m_pack.frame_indices[frames_consumed];
+        }
+        else
+            frame_output = m_pack.start_frame + frames_consumed;
+
+        return frame_output < m_num_frames;
+    }
+
+//member variables
+    /// frame range, cropping, conversion, and chunking settings
+    const TokenGeneratorPack<CvVidFramesGeneratorAlgo> &m_pack;
+    /// number of frames in the source
+    const long long m_num_frames{0};
+    /// frame counter
+    long long m_frames_consumed{0};
+    /// turns frames into tokens
+    std::unique_ptr<CvFrameTokenizer> m_tokenizer{};
+};
+
+
+#endif //header guard
@@ -0,0 +1,120 @@
+// implementation of TokenGeneratorAlgo for generating fragmented frames from a sequence of image files
+
+#ifndef CV_IMAGE_SEQUENCE_GENERATOR_ALGO_3317905_H
+#define CV_IMAGE_SEQUENCE_GENERATOR_ALGO_3317905_H
+
+//local headers
+#include "cv_frame_sequence_batcher.h"
+#include "cv_vid_frames_generator_algo.h"
+#include "exception_assert.h"
+#include "token_generator_algo.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/// generator algorithm type declaration
+class CvImageSequenceGeneratorAlgo;
+
+template <>
+struct TokenGeneratorPack<CvImageSequenceGeneratorAlgo> final
+{
+    /// frame range, cropping, conversion, and chunking settings (the video path is ignored)
+    const TokenGeneratorPack<CvVidFramesGeneratorAlgo> frames{};
+    /// image files in frame order (see cv_open_frame_source())
+    const std::shared_ptr<const std::vector<std::string>> image_paths{};
+};
+
+/// reads the frames of an image sequence and breaks them into chunks for tokenized batched processing
+/// - images are decoded one at a time; image decoders don't depend on earlier frames, so parallel decoding comes from
+///   splitting the sequence between several generator workers (which stay within the thread budget)
+/// - assumes pixels are defined with unsigned chars
+class CvImageSequenceGeneratorAlgo final : public TokenGeneratorAlgo<CvImageSequenceGeneratorAlgo, typename cv::Mat>
+{
+public:
+//constructors
+    /// default constructor: disabled
+    CvImageSequenceGeneratorAlgo() = delete;
+
+    /// normal constructor
+    CvImageSequenceGeneratorAlgo(TokenGeneratorPack<CvImageSequenceGeneratorAlgo> param_pack) :
+        TokenGeneratorAlgo{param_pack}
+    {
+        const auto &frames_pack{m_pack.frames};
+
+        // sanity checks
+        EXCEPTION_ASSERT(m_pack.image_paths && m_pack.image_paths->size());
+
+        // grayscale output can be decoded as grayscale directly
+        m_imread_flags = (frames_pack.convert_to_grayscale || frames_pack.vid_is_grayscale) ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+
+        // frame range, cropping, conversion, and chunking
+        m_batcher = std::make_unique<CvFrameSequenceBatcher>(frames_pack, static_cast<long long>(m_pack.image_paths->size()), false);
+    }
+
+    /// copy constructor: disabled
+    CvImageSequenceGeneratorAlgo(const CvImageSequenceGeneratorAlgo&) = delete;
+
+    /// destructor
+    virtual ~CvImageSequenceGeneratorAlgo() = default;
+
+//overloaded operators
+    /// asignment operator: disabled
+    CvImageSequenceGeneratorAlgo& operator=(const CvImageSequenceGeneratorAlgo&) = delete;
+    CvImageSequenceGeneratorAlgo& operator=(const CvImageSequenceGeneratorAlgo&) const = delete;
+
+//member functions
+    /// get token set from generator (batch of frames each chunked into segments)
+    virtual std::vector<std::unique_ptr<cv::Mat>> GetTokenSet() override
+    {
+        return m_batcher->GetTokenSet(
+                [this](const long long frame_number) -> cv::Mat
+                {
+                    return ReadImage(frame_number);
+                }
+            );
+    }
+
+private:
+    /// read the image of a frame (returns an empty image if it is missing, corrupted, or smaller than the crop region)
+    cv::Mat ReadImage(const long long frame_number) const
+    {
+        const cv::Rect &crop_rectangle{m_pack.frames.crop_rectangle};
+        const std::string &image_path{(*m_pack.image_paths)[frame_number]};
+        cv::Mat image{cv::imread(image_path, m_imread_flags)};
+
+        if (!image.data || image.empty())
+        {
+            std::cerr << "Could not read image: " << image_path << '\n';
+
+            return cv::Mat{};
+        }
+
+        // images should all be the size of the first one
+        if (crop_rectangle.x + crop_rectangle.width > image.cols ||
+            crop_rectangle.y + crop_rectangle.height > image.rows)
+        {
+            std::cerr << "Image is smaller than the crop region: " << image_path << '\n';
+
+            return cv::Mat{};
+        }
+
+        return image;
+    }
+
+//member variables
+    /// reads the frame range in batches
+    std::unique_ptr<CvFrameSequenceBatcher> m_batcher{};
+    /// how images are decoded
+    int m_imread_flags{cv::IMREAD_COLOR};
+};
+
+
+#endif //header guard
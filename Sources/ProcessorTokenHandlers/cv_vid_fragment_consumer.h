@@ -4,6 +4,7 @@
 #define CV_VID_BG_FRAGMENT_CONSUMER_4567876_H
 
 //local headers
+#include "cv_frame_assembler.h"
 #include "cv_util.h"
 #include "exception_assert.h"
 #include "token_batch_consumer.h"
@@ -20,8 +21,9 @@
 
 
 /// tied to CvVidFramesGenerator implementation
-///  note: but does not currently support multiple frames per batch (only one frame with multiple chunks)
+/// each batch holds frames_in_batch frames x chunks_per_frame chunks, laid out [frame1 chunks][frame2 chunks]...
 /// assumes result fragments are passed out in layers (each full set of fragments is stitched together without further thought)
+/// fragments must use the same chunk plan as the generator that split the frames (see cv_chunk_plan())
 class CvVidFragmentConsumer final : public TokenBatchConsumer<cv::Mat, std::list<cv::Mat>>
 {
 public:
@@ -32,23 +34,13 @@ public:
     /// normal constructor
     CvVidFragmentConsumer(const int batch_size,
             const bool collect_timings,
-            const int horizontal_buffer_pixels,
-            const int vertical_buffer_pixels,
-            const int frame_width,
-            const int frame_height) : 
+            const int frames_in_batch,
+            std::shared_ptr<const ChunkPlan> chunk_plan) :
         TokenBatchConsumer{batch_size, collect_timings},
-        m_horizontal_buffer_pixels{horizontal_buffer_pixels},
-        m_vertical_buffer_pixels{vertical_buffer_pixels},
-        m_frame_width{frame_width},
-        m_frame_height{frame_height}
+        m_frame_assembler{frames_in_batch, std::move(chunk_plan)}
     {
         // sanity checks
-        EXCEPTION_ASSERT(m_horizontal_buffer_pixels >= 0);
-        EXCEPTION_ASSERT(m_vertical_buffer_pixels >= 0);
-        EXCEPTION_ASSERT(m_frame_width > 0);
-        EXCEPTION_ASSERT(m_frame_height > 0);
-
-        m_fragments.resize(GetBatchSize());
+        EXCEPTION_ASSERT(m_frame_assembler.BatchSize() == static_cast<std::size_t>(batch_size));
     }
 
     /// copy constructor: disabled
@@ -69,83 +61,43 @@ protected:
     {
         assert(index_in_batch < GetBatchSize());
 
-        m_fragments[index_in_batch].emplace_back(std::move(*intermediate_result));
-
-        // check if a full image can be assembled
-        for (const auto &frag_list : m_fragments)
-        {
-            if (frag_list.empty())
-                return;
-        }
-
-        // add result
-        // pull out a full image
-        std::vector<cv::Mat> img_frags{};
-        img_frags.resize(GetBatchSize());
+        if (!intermediate_result)
+            return;
 
-        for (std::size_t batch_index{0}; batch_index < GetBatchSize(); batch_index++)
-        {
-            img_frags[batch_index] = std::move(m_fragments[batch_index].front());
-            m_fragments[batch_index].pop_front();
-        }
+        // copy the fragment into its frame
+        if (!m_frame_assembler.InsertChunk(*intermediate_result, index_in_batch))
+            std::cerr << "Combining img fragments into image failed unexpectedly!\n";
 
-        // combine result fragments
+        // add results (any frames that were completed)
         cv::Mat result_img{};
-        if (!cv_mat_from_chunks(result_img,
-                img_frags,
-                static_cast<int>(GetBatchSize()),
-                1,
-                m_frame_width,
-                m_frame_height,
-                m_horizontal_buffer_pixels,
-                m_vertical_buffer_pixels)
-            )
-            std::cerr << "Combining img fragments into image failed unexpectedly!\n";
 
-        if (!m_results)
-            m_results = std::make_unique<final_result_type>();
+        while (m_frame_assembler.TryGetFrame(result_img))
+        {
+            if (!m_results)
+                m_results = std::make_unique<final_result_type>();
 
-        m_results->emplace_back(std::move(result_img));
+            m_results->emplace_back(std::move(result_img));
+        }
     }
 
     /// get final result (list of reassembled cv::Mat imgs, aged oldest to youngest)
     virtual std::unique_ptr<final_result_type> GetFinalResult() override
     {
+        if (m_frame_assembler.NumPendingFrames())
+            std::cerr << "Fragments of an incomplete image were dropped unexpectedly!\n";
+
+        m_frame_assembler.Reset();
+
         return std::move(m_results);
     }
 
 private:
 //member variables
-    /// horizontal buffer (pixels) on edge of each chunk (overlap region)
-    const int m_horizontal_buffer_pixels{};
-    /// vertical buffer (pixels) on edge of each chunk (overlap region)
-    const int m_vertical_buffer_pixels{};
-    /// width of each resulting frame (pixels)
-    const int m_frame_width{};
-    /// height of each resulting frame (pixels)
-    const int m_frame_height{};
-
-    /// store image fragments until they are ready to be used
-    std::vector<std::list<token_type>> m_fragments{};
+    /// stitches fragments into their frames
+    CvFrameAssembler m_frame_assembler;
     /// store assembled images
     std::unique_ptr<final_result_type> m_results{};
 };
 
 
 #endif //header guard
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
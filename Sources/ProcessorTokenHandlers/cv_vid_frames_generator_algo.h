@@ -4,15 +4,21 @@
 #define CV_VID_FRAMES_GENERATOR_ALGO_765678987_H
 
 //local headers
+#include "cv_frame_cache.h"
 #include "exception_assert.h"
+#include "rolling_background.h"
 #include "token_generator_algo.h"
 #include "cv_util.h"
+#include "cv_vid_frame_index.h"
 
 //third party headers
 #include <opencv2/opencv.hpp>   //for video manipulation (mainly)
 
 //standard headers
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <iostream>
 #include <memory>
 #include <vector>
 
@@ -20,6 +26,19 @@
 /// generator algorithm type declaration
 class CvVidFramesGeneratorAlgo;
 
+/// shared between frame generators and their owner (thread-safe)
+struct CvVidFramesGeneratorControl final
+{
+    /// set to make the generators stop producing frames early (ends the frame stream)
+    std::atomic<bool> stop_requested{false};
+    /// number of frames produced by all generators sharing this control
+    std::atomic<long long> frames_generated{0};
+    /// number of frames dropped as near-duplicates by all generators sharing this control
+    std::atomic<long long> frames_skipped{0};
+    /// number of requested frames (frame_indices) that could not be reached by all generators (a seek or grab failed)
+    std::atomic<long long> frames_dropped{0};
+};
+
 template <>
 struct TokenGeneratorPack<CvVidFramesGeneratorAlgo> final
 {
@@ -45,6 +64,285 @@ struct TokenGeneratorPack<CvVidFramesGeneratorAlgo> final
     const int horizontal_buffer_pixels{};
     /// vertical buffer (pixels) on edge of each chunk (overlap region)
     const int vertical_buffer_pixels{};
+    /// optional control for stopping early and counting frames (may be shared by several generators)
+    const std::shared_ptr<CvVidFramesGeneratorControl> control{};
+    /// optional frames to grab, in ascending order within [start_frame, last_frame) (empty means grab every frame)
+    /// - short gaps between frames are skipped by grabbing without decoding, long gaps are seeked over
+    const std::vector<long long> frame_indices{};
+    /// number of frames in the rolling background window (<= 0 means frames are emitted as-is)
+    /// - if set, each frame is emitted as its difference from the rolling background (background - frame), then added to the window
+    const int bg_window{0};
+    /// frames between rolling background updates (<= 0 means bg_window)
+    const int bg_update_interval{0};
+    /// background to use until the rolling window is full (same size as the cropped frames)
+    cv::Mat initial_background{};
+    /// drop frames whose mean absolute difference (per element, in pixel value levels) from the last emitted frame is
+    ///   at or below this (<= 0 means emit every frame)
+    /// - frames are compared by a signature downsampled 8x in each dimension, so the check is cheap
+    const double dedup_threshold{0.0};
+    /// optional keyframe index of the video (see cv_vid_frame_index()), for exact seeks (see SeekToFrame())
+    /// - without it, seeks rely on CAP_PROP_POS_FRAMES landing on the requested frame
+    const std::shared_ptr<const CvVidFrameIndex> frame_index{};
+    /// for grayscale output (convert_to_grayscale or vid_is_grayscale): ask the backend not to convert frames to BGR,
+    ///   and use the luma (Y) plane of the raw frames directly when the backend provides it
+    /// - luma is not identical to a BGR->gray conversion (e.g. video-range luma spans 16-235), so backgrounds and
+    ///   frames must come from the same mode
+    /// - frames the backend still converts to 3 channels fall back to the normal grayscale conversion
+    const bool decode_luma{false};
+    /// if chunks should be views into their frame instead of copies (only for processors that don't modify their tokens)
+    const bool share_chunk_data{false};
+    /// rows x cols grid each frame is split into (chunk_rows*chunk_cols must equal chunks_per_frame)
+    /// - 0 x 0 means horizontal row strips (see cv_chunk_grid()), which copy and scan faster than column strips
+    /// - chunks are emitted column by column ([col1 chunks][col2 chunks]...), the layout cv_mat_from_chunks() expects
+    const int chunk_rows{0};
+    const int chunk_cols{0};
+    /// optional precomputed chunk layout of the cropped frames (see cv_chunk_plan()), e.g. to share with the consumer
+    ///   that stitches the chunks back together
+    /// - must match the chunk grid and buffers above; if empty, the generator computes its own
+    const std::shared_ptr<const ChunkPlan> chunk_plan{};
+    /// optional cache to store the cropped grayscale frames in as they are decoded (see CvFrameCacheWriter)
+    /// - frames are stored by their frame number, so the generator must not skip frames (no frame_indices)
+    const std::shared_ptr<CvFrameCacheWriter> frame_cache{};
+    /// max number of threads the video decoder may use internally (<= 0 means the backend's default, see cv_open_video())
+    const int decoder_threads{0};
+};
+
+////
+// turns decoded frames into token sets following the settings of a frame generator pack (shared by frame generators)
+// - crops each frame, converts it to grayscale, drops near-duplicate frames, subtracts the rolling background, and
+//   breaks the frame into chunks
+///
+class CvFrameTokenizer final
+{
+public:
+//member types
+    using token_set_type = std::vector<std::unique_ptr<cv::Mat>>;
+
+//constructors
+    /// default constructor: disabled
+    CvFrameTokenizer() = delete;
+
+    /// normal constructor
+    /// - with 'frames_are_luma', 2-channel frames are packed 4:2:2 luma/chroma (their first channel is taken for grayscale)
+    /// - with 'frames_are_borrowed', frames are views into memory that must not be written (e.g. a read-only file mapping),
+    ///   so whole-frame tokens that would alias them are copied (unless chunks may share data with their frame)
+    CvFrameTokenizer(const TokenGeneratorPack<CvVidFramesGeneratorAlgo> &pack,
+            const bool frames_are_luma,
+            const bool frames_are_borrowed = false) :
+        m_crop_rectangle{pack.crop_rectangle},
+        m_convert_to_grayscale{pack.convert_to_grayscale},
+        m_vid_is_grayscale{pack.vid_is_grayscale},
+        m_frames_are_luma{frames_are_luma},
+        m_frames_are_borrowed{frames_are_borrowed},
+        m_dedup_threshold{pack.dedup_threshold},
+        m_chunks_per_frame{pack.chunks_per_frame},
+        m_share_chunk_data{pack.share_chunk_data}
+    {
+        EXCEPTION_ASSERT(m_chunks_per_frame > 0);
+
+        // chunk grid (row strips by default)
+        int chunk_rows{pack.chunk_rows};
+        int chunk_cols{pack.chunk_cols};
+
+        if (chunk_rows == 0 && chunk_cols == 0)
+        {
+            EXCEPTION_ASSERT(cv_chunk_grid(m_chunks_per_frame,
+                m_crop_rectangle.width,
+                m_crop_rectangle.height,
+                0,
+                chunk_cols,
+                chunk_rows));
+        }
+        else
+        {
+            EXCEPTION_ASSERT(chunk_rows > 0 && chunk_cols > 0);
+            EXCEPTION_ASSERT(chunk_rows*chunk_cols == m_chunks_per_frame);
+        }
+
+        // chunk layout (computed once, the cropped frames all have the same size)
+        if (pack.chunk_plan)
+        {
+            EXCEPTION_ASSERT(pack.chunk_plan->mat_width == m_crop_rectangle.width &&
+                pack.chunk_plan->mat_height == m_crop_rectangle.height);
+            EXCEPTION_ASSERT(pack.chunk_plan->row_divisor == chunk_rows &&
+                pack.chunk_plan->col_divisor == chunk_cols);
+
+            m_chunk_plan = pack.chunk_plan;
+        }
+        else
+        {
+            auto new_chunk_plan{std::make_shared<ChunkPlan>()};
+            EXCEPTION_ASSERT(cv_chunk_plan(*new_chunk_plan,
+                m_crop_rectangle.width,
+                m_crop_rectangle.height,
+                chunk_cols,
+                chunk_rows,
+                pack.horizontal_buffer_pixels,
+                pack.vertical_buffer_pixels));
+
+            m_chunk_plan = std::move(new_chunk_plan);
+        }
+
+        // set up rolling background
+        if (pack.bg_window > 0)
+        {
+            EXCEPTION_ASSERT(pack.initial_background.data && !pack.initial_background.empty());
+            EXCEPTION_ASSERT(pack.initial_background.cols == m_crop_rectangle.width &&
+                pack.initial_background.rows == m_crop_rectangle.height);
+
+            m_rolling_background = std::make_unique<RollingBackground>(pack.bg_window,
+                pack.bg_update_interval,
+                pack.initial_background);
+        }
+    }
+
+    /// copy constructor: disabled
+    CvFrameTokenizer(const CvFrameTokenizer&) = delete;
+
+//destructor: not needed (final class)
+
+//overloaded operators
+    /// copy assignment operator: disabled
+    CvFrameTokenizer& operator=(const CvFrameTokenizer&) = delete;
+
+//member functions
+    /// turn an uncropped frame into tokens, stored in the token set starting at 'chunks_collected' (which is advanced)
+    /// - returns false if the frame was dropped as a near-duplicate of the last emitted frame
+    /// - 'prepared_frame_out' (optional) gets the cropped and converted frame, even if it was dropped
+    bool TokenizeFrame(cv::Mat frame,
+        token_set_type &token_set,
+        std::size_t &chunks_collected,
+        cv::Mat *prepared_frame_out = nullptr)
+    {
+        // crop the frame to desired size
+        frame = frame(m_crop_rectangle);
+
+        // convert to grayscale if desired
+        cv::Mat modified_frame{};
+        bool frame_is_borrowed{m_frames_are_borrowed};
+
+        if (frame.channels() == 1)
+            // already the luma plane (or a grayscale frame): no conversion
+            modified_frame = std::move(frame);
+        else if (m_frames_are_luma && frame.channels() == 2)
+        {
+            // packed 4:2:2 (e.g. YUYV): luma is the first channel
+            cv::extractChannel(frame, modified_frame, 0);
+            frame_is_borrowed = false;
+        }
+        else if (m_vid_is_grayscale)
+        {
+            // video should already be grayscale, so directly get one channel (original grayscale frames have 3 channels)
+            cv::extractChannel(frame, modified_frame, 0);
+            frame_is_borrowed = false;
+        }
+        else if (m_convert_to_grayscale)
+        {
+            // frame sources deliver color frames as BGR (same weights as reading images as grayscale)
+            cv::cvtColor(frame, modified_frame, cv::COLOR_BGR2GRAY);
+            frame_is_borrowed = false;
+        }
+        else
+            modified_frame = std::move(frame);
+
+        if (prepared_frame_out)
+            *prepared_frame_out = modified_frame;
+
+        // drop frames that barely differ from the last emitted frame
+        if (m_dedup_threshold > 0.0 && IsDuplicateFrame(modified_frame))
+            return false;
+
+        // rolling background mode: emit the frame's difference from the current background, then add it to the window
+        if (m_rolling_background)
+        {
+            cv::Mat frame_diff{m_rolling_background->Background() - modified_frame};
+            m_rolling_background->AddFrame(modified_frame);
+            modified_frame = std::move(frame_diff);
+            frame_is_borrowed = false;
+        }
+
+        // break frame into chunks
+        token_set_type temp_chunk_set{};
+
+        if (m_chunks_per_frame == 1 && frame_is_borrowed && !m_share_chunk_data)
+            temp_chunk_set.emplace_back(std::make_unique<cv::Mat>(modified_frame.clone()));
+        else if (m_chunks_per_frame == 1)
+            temp_chunk_set.emplace_back(std::make_unique<cv::Mat>(modified_frame));
+        else if (!cv_mat_to_chunks(modified_frame,
+                temp_chunk_set,
+                *m_chunk_plan,
+                m_share_chunk_data))
+            std::cerr << "Breaking frame into chunks failed unexpectedly!\n";
+
+        // store the set of chunks
+        for (std::size_t set_index{0}; set_index < temp_chunk_set.size(); set_index++)
+        {
+            token_set[chunks_collected] = std::move(temp_chunk_set[set_index]);
+            chunks_collected++;
+        }
+
+        return true;
+    }
+
+    /// forget the last emitted frame (e.g. when the frame stream restarts)
+    void Reset()
+    {
+        m_last_signature = cv::Mat{};
+    }
+
+private:
+    /// check if a frame is a near-duplicate of the last emitted frame (if not, it becomes the new reference)
+    bool IsDuplicateFrame(const cv::Mat &frame)
+    {
+        // cheap signature: block averages over s_dedup_downsample x s_dedup_downsample pixels
+        cv::Mat signature{};
+        cv::resize(frame,
+            signature,
+            cv::Size{std::max(1, frame.cols/s_dedup_downsample), std::max(1, frame.rows/s_dedup_downsample)},
+            0,
+            0,
+            cv::INTER_AREA);
+
+        if (!m_last_signature.empty())
+        {
+            const double mean_difference{cv::norm(signature, m_last_signature, cv::NORM_L1) / static_cast<double>(signature.total()*signature.channels())};
+
+            if (mean_difference <= m_dedup_threshold)
+                return true;
+        }
+
+        m_last_signature = std::move(signature);
+
+        return false;
+    }
+
+//member variables
+    /// downsampling factor (each dimension) of the frame signatures compared for dropping near-duplicate frames
+    static constexpr int s_dedup_downsample{8};
+
+    /// rectangle for cropping the frames
+    const cv::Rect m_crop_rectangle{};
+    /// if frames should be converted to grayscale
+    const bool m_convert_to_grayscale{};
+    /// if frames are already grayscale (stored in 3 channels)
+    const bool m_vid_is_grayscale{};
+    /// if 2-channel frames are packed luma/chroma
+    const bool m_frames_are_luma{};
+    /// if frames are views into memory that must not be written
+    const bool m_frames_are_borrowed{};
+    /// near-duplicate frame threshold (<= 0 means keep every frame)
+    const double m_dedup_threshold{};
+    /// number of chunks to break each frame into
+    const int m_chunks_per_frame{};
+    /// if chunks should be views into their frame
+    const bool m_share_chunk_data{};
+
+    /// layout of the chunks each frame is split into
+    std::shared_ptr<const ChunkPlan> m_chunk_plan{};
+    /// sliding-window background (only in rolling background mode)
+    std::unique_ptr<RollingBackground> m_rolling_background{};
+    /// signature of the last emitted frame (only when dropping near-duplicate frames)
+    cv::Mat m_last_signature{};
 };
 
 /// derive from this class with implementation of 'result handling'
@@ -62,7 +360,7 @@ public:
         TokenGeneratorAlgo{param_pack}
     {
         // open video
-        m_vid = cv::VideoCapture{param_pack.vid_path};
+        cv_open_video(m_vid, param_pack.vid_path, param_pack.decoder_threads);
 
         // sanity checks
         EXCEPTION_ASSERT(m_pack.batch_size == m_pack.frames_in_batch*m_pack.chunks_per_frame);
@@ -71,6 +369,7 @@ public:
         int frame_width{static_cast<int>(m_vid.get(cv::CAP_PROP_FRAME_WIDTH))};
         int frame_height{static_cast<int>(m_vid.get(cv::CAP_PROP_FRAME_HEIGHT))};
 
+        EXCEPTION_ASSERT(m_pack.frame_indices.empty() || !m_pack.frame_cache);
         EXCEPTION_ASSERT(m_pack.horizontal_buffer_pixels >= 0);
         EXCEPTION_ASSERT(m_pack.vertical_buffer_pixels >= 0);
         EXCEPTION_ASSERT(frame_width > 0);
@@ -89,19 +388,38 @@ public:
         EXCEPTION_ASSERT(m_pack.crop_rectangle.x + m_pack.crop_rectangle.width <= frame_width &&
             m_pack.crop_rectangle.y + m_pack.crop_rectangle.height <= frame_height);
 
-        // start video on 'start frame'
+        // start video on 'start frame' (the index counts the frames, the container only estimates them)
+        const long long frame_count{m_pack.frame_index ?
+            m_pack.frame_index->frame_count :
+            static_cast<long long>(m_vid.get(cv::CAP_PROP_FRAME_COUNT))};
         EXCEPTION_ASSERT(m_pack.start_frame >= 0);
-        EXCEPTION_ASSERT(m_pack.start_frame < static_cast<int>(m_vid.get(cv::CAP_PROP_FRAME_COUNT)));
-        m_vid.set(cv::CAP_PROP_POS_FRAMES, m_pack.start_frame);
+        EXCEPTION_ASSERT(m_pack.start_frame < frame_count);
+        ResetToStartFrame();
 
         // validate last frame
         EXCEPTION_ASSERT(m_pack.last_frame > 0);
         EXCEPTION_ASSERT(m_pack.last_frame - m_pack.start_frame > 0);
         //note: if last_frame > num_frames ignore it
 
+        // validate frame indices
+        for (std::size_t index{0}; index < m_pack.frame_indices.size(); index++)
+        {
+            EXCEPTION_ASSERT(m_pack.frame_indices[index] >= m_pack.start_frame && m_pack.frame_indices[index] < m_pack.last_frame);
+            EXCEPTION_ASSERT(index == 0 || m_pack.frame_indices[index] > m_pack.frame_indices[index - 1]);
+        }
+
+        // luma decoding: skip the backend's color conversion so the Y plane can be taken directly
+        m_decode_luma = m_pack.decode_luma && (m_pack.convert_to_grayscale || m_pack.vid_is_grayscale);
+        m_frame_height = frame_height;
+
+        if (m_decode_luma)
+            m_vid.set(cv::CAP_PROP_CONVERT_RGB, false);
         // try to interpet video frames as RGB format for consistency (only when not grayscale already)
-        if (!m_pack.vid_is_grayscale)
+        else if (!m_pack.vid_is_grayscale)
             m_vid.set(cv::CAP_PROP_CONVERT_RGB, true);
+
+        // cropping, grayscale conversion, and chunking
+        m_tokenizer = std::make_unique<CvFrameTokenizer>(m_pack, m_decode_luma);
     }
 
     /// copy constructor: disabled
@@ -122,15 +440,42 @@ public:
         token_set_type return_token_set{};
         std::size_t chunks_collected{0};
 
-        for (std::size_t batch_index{0}; batch_index < m_pack.batch_size/m_pack.chunks_per_frame; batch_index++)
+        int frames_collected{0};
+
+        while (frames_collected < m_pack.frames_in_batch)
         {
             // leave if reached the last frame
             if (m_frames_consumed >= m_pack.last_frame - m_pack.start_frame)
                 break;
 
+            // move to the next requested frame (leave if there are none left)
+            if (m_pack.frame_indices.size())
+            {
+                if (m_frames_consumed >= static_cast<long long>(m_pack.frame_indices.size()))
+                    break;
+
+                // the video can't be read past a failed seek or grab, so drop the rest of the requested frames
+                if (!MoveToFrame(m_pack.frame_indices[m_frames_consumed]))
+                {
+                    const long long frames_left{static_cast<long long>(m_pack.frame_indices.size()) - m_frames_consumed};
+
+                    if (m_pack.control)
+                        m_pack.control->frames_dropped += frames_left;
+
+                    m_frames_consumed += frames_left;
+
+                    break;
+                }
+            }
+
+            // leave if the owner wants no more frames
+            if (m_pack.control && m_pack.control->stop_requested)
+                break;
+
             // get next frame from video
             cv::Mat frame{};
             m_vid >> frame;
+            m_next_frame++;
 
             // leave if reached the end of the video or frame is corrupted
             if (!frame.data || frame.empty())
@@ -140,56 +485,134 @@ public:
             if (!return_token_set.size())
                 return_token_set.resize(m_pack.batch_size);
 
-            // crop the frame to desired size
-            frame = frame(m_pack.crop_rectangle);
+            // raw planar frames (e.g. I420 as one (3/2 x height) x width channel) start with the Y plane
+            if (m_decode_luma && frame.channels() == 1 && frame.rows > m_frame_height)
+                frame = frame.rowRange(0, m_frame_height);
 
-            // convert to grayscale if desired
-            cv::Mat modified_frame{};
+            // crop, convert, and chunk the frame (leave it out if it barely differs from the last emitted frame)
+            const long long frame_number{m_next_frame - 1};
+            cv::Mat prepared_frame{};
+            const bool frame_kept{m_tokenizer->TokenizeFrame(std::move(frame),
+                return_token_set,
+                chunks_collected,
+                m_pack.frame_cache ? &prepared_frame : nullptr)};
 
-            if (m_pack.vid_is_grayscale)
-                // video should already be grayscale, so directly get one channel (original grayscale frames have 3 channels)
-                cv::extractChannel(frame, modified_frame, 0);
-            else if (m_pack.convert_to_grayscale)
-                // this should always work since the vid's CAP_PROP_CONVERT_RGB property was set
-                cv::cvtColor(frame, modified_frame, cv::COLOR_RGB2GRAY);
-            else
-                modified_frame = std::move(frame);
+            // store the frame for later passes over the video
+            if (m_pack.frame_cache)
+                m_pack.frame_cache->WriteFrame(frame_number, prepared_frame);
 
-            // break frame into chunks
-            token_set_type temp_chunk_set{};
+            if (!frame_kept)
+            {
+                m_frames_consumed++;
 
-            if (m_pack.chunks_per_frame == 1)
-                temp_chunk_set.emplace_back(std::make_unique<cv::Mat>(modified_frame));
-            else if (!cv_mat_to_chunks(modified_frame, temp_chunk_set, static_cast<int>(m_pack.batch_size), 1, m_pack.horizontal_buffer_pixels, m_pack.vertical_buffer_pixels))
-                std::cerr << "Breaking frame (" << m_frames_consumed + 1 << ") into chunks failed unexpectedly!\n";
+                if (m_pack.control)
+                    m_pack.control->frames_skipped++;
 
-            // store the set of chunks
-            for (std::size_t set_index{0}; set_index < temp_chunk_set.size(); set_index++)
-            {
-                return_token_set[chunks_collected] = std::move(temp_chunk_set[set_index]);
-                chunks_collected++;
+                continue;
             }
 
             m_frames_consumed++;
+            frames_collected++;
+
+            if (m_pack.control)
+                m_pack.control->frames_generated++;
         }
 
         // reset if failed to get any frames/frame chunks
         if (!return_token_set.size())
         {
             // point video back to start frame
-            m_vid.set(cv::CAP_PROP_POS_FRAMES, m_pack.start_frame);
-            m_frames_consumed = 0;
+            ResetToStartFrame();
+            m_tokenizer->Reset();
         }
 
         return return_token_set;
     }
 
 private:
+    /// point the video back to the start frame
+    /// - if that fails, warn and produce no more frames instead of the wrong ones
+    void ResetToStartFrame()
+    {
+        if (SeekToFrame(m_pack.start_frame))
+        {
+            m_frames_consumed = 0;
+
+            return;
+        }
+
+        std::cerr << "warning, could not seek to frame " << m_pack.start_frame << " of video: " << m_pack.vid_path << '\n';
+        m_frames_consumed = m_pack.last_frame - m_pack.start_frame;
+    }
+
+    /// position the video so the next frame read is 'target_frame' (in any direction); returns false if that failed
+    /// - with a frame index, seeks to the keyframe at or before the target and grabs forward to it while counting
+    ///   frames, so the position is exact in the index's (display-order) numbering
+    /// - without one, relies on CAP_PROP_POS_FRAMES landing on the target, which can be inaccurate (e.g. for H.264)
+    /// - a seek fails if the backend reports a different position than requested (except at the start of the video,
+    ///   since some backends don't report it), or the video ends before the target
+    bool SeekToFrame(const long long target_frame)
+    {
+        const long long seek_frame{m_pack.frame_index ?
+            cv_vid_keyframe_at_or_before(*m_pack.frame_index, target_frame) :
+            target_frame};
+
+        m_vid.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(seek_frame));
+        bool seek_succeeded{seek_frame == 0 || static_cast<long long>(m_vid.get(cv::CAP_PROP_POS_FRAMES)) == seek_frame};
+
+        for (long long frame{seek_frame}; frame < target_frame && seek_succeeded; frame++)
+            seek_succeeded = m_vid.grab();
+
+        m_next_frame = target_frame;
+
+        return seek_succeeded;
+    }
+
+    /// position the video so the next frame read is 'target_frame' (must not be behind the current position)
+    bool MoveToFrame(const long long target_frame)
+    {
+        const long long gap{target_frame - m_next_frame};
+        assert(gap >= 0);
+
+        // seeking to the keyframe before the target decodes forward from the keyframe before the backend's back-off
+        //   point, which is cheaper than decoding the whole gap if that keyframe is in the gap (known with an index,
+        //   otherwise assumed for long gaps)
+        const bool seek_skips_keyframe{m_pack.frame_index ?
+            cv_vid_keyframe_at_or_before(*m_pack.frame_index,
+                cv_vid_keyframe_at_or_before(*m_pack.frame_index, target_frame) - CV_VID_SEEK_BACKOFF_FRAMES) > m_next_frame :
+            gap > s_max_grab_gap};
+
+        if (seek_skips_keyframe)
+            return SeekToFrame(target_frame);
+
+        // grabbing skips frames without converting them
+        for (long long skipped{0}; skipped < gap; skipped++)
+        {
+            if (!m_vid.grab())
+                return false;
+        }
+
+        m_next_frame = target_frame;
+
+        return true;
+    }
+
 //member variables
+    /// largest gap between requested frames that is skipped by grabbing instead of seeking (roughly a keyframe interval)
+    static constexpr long long s_max_grab_gap{30};
+
     /// video for processing
     cv::VideoCapture m_vid{};
     /// frame counter
     long long m_frames_consumed{0};
+    /// index of the frame the video will read next
+    long long m_next_frame{0};
+    /// turns frames into tokens
+    std::unique_ptr<CvFrameTokenizer> m_tokenizer{};
+    /// if frames are decoded without color conversion, to take their luma plane
+    bool m_decode_luma{false};
+    /// height of the uncropped frames
+    int m_frame_height{0};
 };
 
 
@@ -0,0 +1,77 @@
+// implementation of TokenBatchConsumer for summing element-wise histograms from several shards
+
+#ifndef HISTOGRAM_MERGE_CONSUMER_5530912_H
+#define HISTOGRAM_MERGE_CONSUMER_5530912_H
+
+//local headers
+#include "element_histograms.h"
+#include "token_batch_consumer.h"
+
+//third party headers
+
+//standard headers
+#include <cassert>
+#include <memory>
+
+
+/// tied to HistogramShardAlgo implementation
+/// reduction step for temporal shards: every histogram set consumed is added to a running total
+template <typename T>
+class HistogramMergeConsumer final : public TokenBatchConsumer<ElementHistograms<T>, ElementHistograms<T>>
+{
+public:
+//member types
+    using token_type = ElementHistograms<T>;
+    using final_result_type = ElementHistograms<T>;
+
+//constructors
+    /// default constructor: disabled
+    HistogramMergeConsumer() = delete;
+
+    /// normal constructor
+    HistogramMergeConsumer(const int batch_size,
+            const bool collect_timings) :
+        TokenBatchConsumer<ElementHistograms<T>, ElementHistograms<T>>{batch_size, collect_timings}
+    {}
+
+    /// copy constructor: disabled
+    HistogramMergeConsumer(const HistogramMergeConsumer&) = delete;
+
+//destructor: not needed
+
+//overloaded operators
+    /// asignment operator: disabled
+    HistogramMergeConsumer& operator=(const HistogramMergeConsumer&) = delete;
+    HistogramMergeConsumer& operator=(const HistogramMergeConsumer&) const = delete;
+
+protected:
+//member functions
+    /// consume a shard's histograms
+    virtual void ConsumeTokenImpl(std::unique_ptr<token_type> shard_histograms, const std::size_t index_in_batch) override
+    {
+        assert(index_in_batch < this->GetBatchSize());
+
+        if (!shard_histograms)
+            return;
+
+        // the first shard becomes the running total
+        if (!m_merged)
+            m_merged = std::move(shard_histograms);
+        else
+            m_merged->Merge(*shard_histograms);
+    }
+
+    /// get final result (sum of all histograms consumed)
+    virtual std::unique_ptr<final_result_type> GetFinalResult() override
+    {
+        return std::move(m_merged);
+    }
+
+private:
+//member variables
+    /// running total of all shards consumed
+    std::unique_ptr<final_result_type> m_merged{};
+};
+
+
+#endif //header guard
@@ -0,0 +1,108 @@
+// takes in cv::Mat fragments of frames, stitches them into whole frames, and passes the frames on
+
+#ifndef MAT_FRAGMENT_INTERMEDIARY_6620914_H
+#define MAT_FRAGMENT_INTERMEDIARY_6620914_H
+
+//local headers
+#include "cv_frame_assembler.h"
+#include "cv_util.h"
+#include "exception_assert.h"
+#include "token_process_intermediary.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+
+/// designed to stand between an AsyncTokenProcess working on the chunks of frames (e.g. one tile per unit)
+///  and an AsyncTokenProcess consuming vectors of cv::Mats that are treated as single tokens
+/// each batch holds frames_in_batch frames x chunks_per_frame chunks (see CvFrameAssembler); fragments are stitched
+///  into their frames with the chunk plan that split them (see cv_chunk_plan()), and each frame is passed on by itself
+///  as soon as it is complete
+class MatFragmentIntermediary final : public TokenProcessIntermediary<cv::Mat, std::vector<cv::Mat>, bool>
+{
+//member types
+public:
+//constructors
+    /// default constructor: disabled
+    MatFragmentIntermediary() = delete;
+
+    /// normal constructor
+    MatFragmentIntermediary(const int batch_size,
+            const bool collect_timings,
+            const int max_shuttle_queue_size,
+            const int frames_in_batch,
+            std::shared_ptr<const ChunkPlan> chunk_plan) :
+        // output batch size is 1
+        TokenProcessIntermediary{batch_size, 1, collect_timings, max_shuttle_queue_size},
+        m_frame_assembler{frames_in_batch, std::move(chunk_plan)}
+    {
+        // sanity checks
+        EXCEPTION_ASSERT(m_frame_assembler.BatchSize() == static_cast<std::size_t>(batch_size));
+    }
+
+    /// copy constructor: disabled
+    MatFragmentIntermediary(const MatFragmentIntermediary&) = delete;
+
+//destructor: default
+    virtual ~MatFragmentIntermediary() = default;
+
+//overloaded operators
+    /// asignment operator: disabled
+    MatFragmentIntermediary& operator=(const MatFragmentIntermediary&) = delete;
+    MatFragmentIntermediary& operator=(const MatFragmentIntermediary&) const = delete;
+
+//member functions
+    /// consume a fragment from first process
+    virtual void ConsumeTokenImpl(std::unique_ptr<cv::Mat> input_token, const std::size_t index_in_batch) override
+    {
+        assert(index_in_batch < m_frame_assembler.BatchSize());
+
+        if (!input_token)
+            return;
+
+        // copy the fragment into its frame
+        if (!m_frame_assembler.InsertChunk(*input_token, index_in_batch))
+            std::cerr << "Combining img fragments into image failed unexpectedly!\n";
+
+        // send any frames that were completed
+        std::vector<cv::Mat> new_batch(1);
+
+        while (m_frame_assembler.TryGetFrame(new_batch.front()))
+        {
+            // the frame is considered 'one output token', so it must be wrapped for TokenBatchGenerator
+            std::vector<std::unique_ptr< std::vector<cv::Mat> >> out_token{};
+            out_token.emplace_back(std::make_unique<std::vector<cv::Mat>>(std::move(new_batch)));
+
+            // send the token to the generator so the second AsyncTokenProcess can use it
+            AddNextBatch(out_token);
+
+            new_batch = std::vector<cv::Mat>(1);
+        }
+    }
+
+    /// clean up remaining fragments (unique ptr return type is an API requirement)
+    virtual std::unique_ptr<bool> GetFinalResultImpl() override
+    {
+        // incomplete frames can't be stitched, so they are dropped
+        if (m_frame_assembler.NumPendingFrames())
+            std::cerr << "Fragments of an incomplete frame were dropped unexpectedly!\n";
+
+        m_frame_assembler.Reset();
+
+        return std::make_unique<bool>(true);
+    }
+
+private:
+//member variables
+    /// stitches fragments into their frames
+    CvFrameAssembler m_frame_assembler;
+};
+
+
+#endif //header guard
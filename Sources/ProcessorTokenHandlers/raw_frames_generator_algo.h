@@ -0,0 +1,98 @@
+// implementation of TokenGeneratorAlgo for generating fragmented frames from a memory-mapped raw frame file
+
+#ifndef RAW_FRAMES_GENERATOR_ALGO_2290417_H
+#define RAW_FRAMES_GENERATOR_ALGO_2290417_H
+
+//local headers
+#include "cv_frame_sequence_batcher.h"
+#include "cv_frame_source.h"
+#include "cv_vid_frames_generator_algo.h"
+#include "exception_assert.h"
+#include "token_generator_algo.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cassert>
+#include <memory>
+#include <vector>
+
+
+/// generator algorithm type declaration
+class RawFramesGeneratorAlgo;
+
+template <>
+struct TokenGeneratorPack<RawFramesGeneratorAlgo> final
+{
+    /// frame range, cropping, conversion, and chunking settings (the video path is ignored)
+    const TokenGeneratorPack<CvVidFramesGeneratorAlgo> frames{};
+    /// the mapped frames (see cv_open_frame_source())
+    const std::shared_ptr<const CvRawFrames> raw_frames{};
+};
+
+/// reads raw frames straight out of a file mapping and breaks them into chunks for tokenized batched processing
+/// - frames need no decoding, and gray8/bgr24 frames (or the luma plane of YUV frames with 'decode_luma') are not copied
+///   until they are chunked; with 'share_chunk_data' the chunks are views into the mapping (read-only processors only)
+/// - the mapping is kept alive by this generator's pack, but tokens sharing data with it must not outlive the mapping
+class RawFramesGeneratorAlgo final : public TokenGeneratorAlgo<RawFramesGeneratorAlgo, typename cv::Mat>
+{
+public:
+//constructors
+    /// default constructor: disabled
+    RawFramesGeneratorAlgo() = delete;
+
+    /// normal constructor
+    RawFramesGeneratorAlgo(TokenGeneratorPack<RawFramesGeneratorAlgo> param_pack) :
+        TokenGeneratorAlgo{param_pack}
+    {
+        const auto &frames_pack{m_pack.frames};
+
+        // sanity checks
+        EXCEPTION_ASSERT(m_pack.raw_frames && m_pack.raw_frames->file && m_pack.raw_frames->frame_offsets.size());
+        EXCEPTION_ASSERT(frames_pack.crop_rectangle.x + frames_pack.crop_rectangle.width <= m_pack.raw_frames->frame_width &&
+            frames_pack.crop_rectangle.y + frames_pack.crop_rectangle.height <= m_pack.raw_frames->frame_height);
+
+        // luma mode: use the Y plane of YUV frames directly (same caveats as decoding a video's luma)
+        m_luma_only = frames_pack.decode_luma && (frames_pack.convert_to_grayscale || frames_pack.vid_is_grayscale);
+
+        // frame range, cropping, conversion, and chunking (frames are views into the read-only mapping)
+        m_batcher = std::make_unique<CvFrameSequenceBatcher>(frames_pack,
+            static_cast<long long>(m_pack.raw_frames->frame_offsets.size()),
+            true);
+    }
+
+    /// copy constructor: disabled
+    RawFramesGeneratorAlgo(const RawFramesGeneratorAlgo&) = delete;
+
+    /// destructor
+    virtual ~RawFramesGeneratorAlgo() = default;
+
+//overloaded operators
+    /// asignment operator: disabled
+    RawFramesGeneratorAlgo& operator=(const RawFramesGeneratorAlgo&) = delete;
+    RawFramesGeneratorAlgo& operator=(const RawFramesGeneratorAlgo&) const = delete;
+
+//member functions
+    /// get token set from generator (batch of frames each chunked into segments)
+    virtual std::vector<std::unique_ptr<cv::Mat>> GetTokenSet() override
+    {
+        // get frames from the mapping
+        return m_batcher->GetTokenSet(
+                [this](const long long frame_number) -> cv::Mat
+                {
+                    return cv_raw_frame(*m_pack.raw_frames, frame_number, m_luma_only);
+                }
+            );
+    }
+
+private:
+//member variables
+    /// reads the frame range in batches
+    std::unique_ptr<CvFrameSequenceBatcher> m_batcher{};
+    /// if YUV frames are reduced to their luma plane
+    bool m_luma_only{false};
+};
+
+
+#endif //header guard
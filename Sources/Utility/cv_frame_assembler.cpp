@@ -0,0 +1,106 @@
+// assembles frames from the chunks of batches of consecutive frames
+
+//paired header
+#include "cv_frame_assembler.h"
+
+//local headers
+#include "cv_util.h"
+#include "exception_assert.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+CvFrameAssembler::CvFrameAssembler(const int frames_in_batch, std::shared_ptr<const ChunkPlan> chunk_plan) :
+	m_chunk_plan{std::move(chunk_plan)},
+	m_frames_in_batch{frames_in_batch > 0 ? static_cast<std::size_t>(frames_in_batch) : 0},
+	m_chunks_per_frame{m_chunk_plan ? m_chunk_plan->chunks.size() : 0}
+{
+	EXCEPTION_ASSERT(m_chunk_plan);
+	EXCEPTION_ASSERT(m_frames_in_batch > 0 && m_chunks_per_frame > 0);
+
+	m_chunks_received.resize(BatchSize(), 0);
+}
+
+bool CvFrameAssembler::InsertChunk(const cv::Mat &chunk, const std::size_t index_in_batch)
+{
+	EXCEPTION_ASSERT(index_in_batch < BatchSize());
+
+	// which frame and which part of it the chunk belongs to
+	const long long batch_number{m_chunks_received[index_in_batch]++};
+	const long long frame_number{batch_number*static_cast<long long>(m_frames_in_batch) +
+		static_cast<long long>(index_in_batch / m_chunks_per_frame)};
+	const BorderedChunk &chunk_layout{m_chunk_plan->chunks[index_in_batch % m_chunks_per_frame]};
+
+	if (frame_number < m_first_frame)
+		return false;
+
+	// the chunk must have the size of its part of the frame (including buffers)
+	if (!chunk.data ||
+		chunk.empty() ||
+		chunk.cols != chunk_layout.chunk_width ||
+		chunk.rows != chunk_layout.chunk_height)
+		return false;
+
+	// extend the ring to the chunk's frame
+	const std::size_t ring_index{static_cast<std::size_t>(frame_number - m_first_frame)};
+
+	while (m_frame_ring.size() <= ring_index)
+	{
+		m_frame_ring.emplace_back();
+		m_frame_chunk_counts.emplace_back(0);
+	}
+
+	// allocate the frame with its first chunk
+	cv::Mat &frame{m_frame_ring[ring_index]};
+
+	if (frame.empty())
+		frame.create(m_chunk_plan->mat_height, m_chunk_plan->mat_width, chunk.type());
+	else if (frame.type() != chunk.type())
+		return false;
+
+	// copy non-buffered component of the chunk into its place in the frame
+	chunk(cv::Rect(
+			chunk_layout.original_x - chunk_layout.corner_x,
+			chunk_layout.original_y - chunk_layout.corner_y,
+			chunk_layout.original_width,
+			chunk_layout.original_height
+		)).copyTo(frame(cv::Rect(
+			chunk_layout.original_x,
+			chunk_layout.original_y,
+			chunk_layout.original_width,
+			chunk_layout.original_height
+		)));
+
+	m_frame_chunk_counts[ring_index]++;
+
+	return true;
+}
+
+bool CvFrameAssembler::TryGetFrame(cv::Mat &frame_output)
+{
+	if (m_frame_ring.empty() || m_frame_chunk_counts.front() < m_chunks_per_frame)
+		return false;
+
+	frame_output = std::move(m_frame_ring.front());
+	m_frame_ring.pop_front();
+	m_frame_chunk_counts.pop_front();
+	m_first_frame++;
+
+	return true;
+}
+
+void CvFrameAssembler::Reset()
+{
+	m_frame_ring.clear();
+	m_frame_chunk_counts.clear();
+	m_first_frame = 0;
+
+	for (auto &chunks_received : m_chunks_received)
+		chunks_received = 0;
+}
@@ -0,0 +1,84 @@
+// assembles frames from the chunks of batches of consecutive frames
+
+#ifndef CV_FRAME_ASSEMBLER_3318205_H
+#define CV_FRAME_ASSEMBLER_3318205_H
+
+//local headers
+#include "cv_util.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+//forward declarations
+
+
+////
+// stitches frames together from batches of frames_in_batch frames x chunks_per_frame chunks
+// - batch indices are laid out [frame1 chunks][frame2 chunks]... (see CvVidFramesGeneratorAlgo), and each batch index
+//   receives its chunks in batch order
+// - each chunk is copied straight into its frame, which is allocated when its first chunk arrives; frames that are
+//   still missing chunks wait in a ring, and completed frames are handed out in order
+///
+class CvFrameAssembler final
+{
+public:
+//constructors
+	/// default constructor: disabled
+	CvFrameAssembler() = delete;
+
+	/// normal constructor
+	CvFrameAssembler(const int frames_in_batch, std::shared_ptr<const ChunkPlan> chunk_plan);
+
+	/// copy constructor: disabled
+	CvFrameAssembler(const CvFrameAssembler&) = delete;
+
+//destructor: default
+
+//overloaded operators
+	/// copy assignment operator: disabled
+	CvFrameAssembler& operator=(const CvFrameAssembler&) = delete;
+
+//member functions
+	/// number of chunks in one batch
+	std::size_t BatchSize() const { return m_chunks_per_frame*m_frames_in_batch; }
+
+	/// copy a chunk into its frame
+	/// - returns false if the chunk doesn't fit the chunk plan (the chunk is skipped, so its frame never completes)
+	bool InsertChunk(const cv::Mat &chunk, const std::size_t index_in_batch);
+
+	/// take the oldest frame out if all its chunks arrived
+	bool TryGetFrame(cv::Mat &frame_output);
+
+	/// number of frames that are started but not handed out yet
+	std::size_t NumPendingFrames() const { return m_frame_ring.size(); }
+
+	/// drop all pending frames and start over
+	void Reset();
+
+private:
+//member variables
+	/// layout of the chunks within a frame
+	const std::shared_ptr<const ChunkPlan> m_chunk_plan{};
+	/// number of frames per batch
+	const std::size_t m_frames_in_batch{};
+	/// number of chunks per frame
+	const std::size_t m_chunks_per_frame{};
+
+	/// number of chunks received by each batch index
+	std::vector<long long> m_chunks_received{};
+	/// frames being assembled, starting with frame number m_first_frame
+	std::deque<cv::Mat> m_frame_ring{};
+	/// number of chunks copied into each frame in the ring
+	std::deque<std::size_t> m_frame_chunk_counts{};
+	/// frame number of the front of the ring
+	long long m_first_frame{0};
+};
+
+
+#endif //header guard
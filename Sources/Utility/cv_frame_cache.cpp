@@ -0,0 +1,290 @@
+// cache of a video's decoded frames (cropped and grayscale), so later passes over the video don't decode it again
+
+//paired header
+#include "cv_frame_cache.h"
+
+//local headers
+#include "cv_frame_source.h"
+#include "exception_assert.h"
+#include "string_utils.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+
+/// marker that starts each frame record
+static const char s_frame_marker[6]{'F', 'R', 'A', 'M', 'E', '\n'};
+
+/// FNV-1a hash of some bytes
+static std::uint64_t hash_bytes(const void *bytes, const std::size_t num_bytes, std::uint64_t hash = 14695981039346656037ULL)
+{
+	const unsigned char *byte_ptr{static_cast<const unsigned char*>(bytes)};
+
+	for (std::size_t byte_index{0}; byte_index < num_bytes; byte_index++)
+	{
+		hash ^= byte_ptr[byte_index];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+std::string cv_frame_cache_key(const std::string &vid_path, const cv::Rect &crop_region, const bool vid_is_grayscale, const bool decode_luma)
+{
+	std::uint64_t key{hash_bytes(vid_path.data(), vid_path.size())};
+
+	// the video's size and modification time catch almost every change
+	struct stat file_stats{};
+
+	if (stat(vid_path.c_str(), &file_stats) == 0)
+	{
+		const std::int64_t file_size{static_cast<std::int64_t>(file_stats.st_size)};
+		const std::int64_t file_mtime{static_cast<std::int64_t>(file_stats.st_mtime)};
+
+		key = hash_bytes(&file_size, sizeof(file_size), key);
+		key = hash_bytes(&file_mtime, sizeof(file_mtime), key);
+	}
+
+	// the frames' pixels depend on the crop region and how they were made grayscale
+	const std::string frame_settings{format_string("%d,%d,%d,%d|%s",
+		crop_region.x,
+		crop_region.y,
+		crop_region.width,
+		crop_region.height,
+		decode_luma ? "luma" : (vid_is_grayscale ? "channel0" : "bgr2gray"))};
+
+	key = hash_bytes(frame_settings.data(), frame_settings.size(), key);
+
+	return format_string("%016llx", static_cast<unsigned long long>(key));
+}
+
+bool cv_open_frame_cache(const std::string &cache_path,
+	const std::string &key,
+	const cv::Rect &crop_region,
+	const long long min_frames,
+	CvFrameSource &source_output)
+{
+	// check the stream header before mapping the file
+	std::ifstream cache_file{cache_path};
+	std::string header{};
+
+	if (!cache_file || !std::getline(cache_file, header))
+		return false;
+
+	if (header.compare(0, 10, "YUV4MPEG2 ") != 0 || header.find(" XCVVIDKEY=" + key) == std::string::npos)
+		return false;
+
+	// a cache of part of the video only serves requests for fewer frames
+	const std::size_t frames_pos{header.find(" XCVVIDFRAMES=")};
+
+	if (frames_pos == std::string::npos)
+		return false;
+
+	const long long requested_frames{std::atoll(header.c_str() + frames_pos + 14)};
+
+	if (requested_frames >= 0 && (min_frames < 0 || requested_frames < min_frames))
+		return false;
+
+	// frames are read like any other y4m file
+	CvFrameSource cache_source{};
+
+	if (!cv_open_frame_source(cache_path, "", cache_source))
+		return false;
+
+	if (cache_source.frame_width != crop_region.width || cache_source.frame_height != crop_region.height)
+		return false;
+
+	cache_source.source_crop = crop_region;
+	source_output = std::move(cache_source);
+
+	return true;
+}
+
+/// stream header of a frame cache (the frame count has a fixed width, so Finish() can rewrite it in place)
+static std::string frame_cache_header(const int frame_width,
+	const int frame_height,
+	const double fps,
+	const std::string &key,
+	const long long frames)
+{
+	// frame rate as a ratio of integers (y4m requires one, 0 is 'unknown')
+	return format_string("YUV4MPEG2 W%d H%d F%lld:1000 Ip A1:1 Cmono XCVVIDKEY=%s XCVVIDFRAMES=%020lld\n",
+		frame_width,
+		frame_height,
+		static_cast<long long>(fps*1000.0 + 0.5),
+		key.c_str(),
+		frames);
+}
+
+/// write all bytes at an offset of a file (returns false on any error, e.g. a full disk)
+static bool write_all_at(const int fd, const unsigned char *bytes, std::size_t num_bytes, off_t offset)
+{
+	while (num_bytes > 0)
+	{
+		const ssize_t bytes_written{pwrite(fd, bytes, num_bytes, offset)};
+
+		if (bytes_written < 0 && errno == EINTR)
+			continue;
+
+		if (bytes_written <= 0)
+			return false;
+
+		bytes += bytes_written;
+		num_bytes -= static_cast<std::size_t>(bytes_written);
+		offset += bytes_written;
+	}
+
+	return true;
+}
+
+CvFrameCacheWriter::CvFrameCacheWriter(const std::string &cache_path,
+	const std::string &key,
+	const int frame_width,
+	const int frame_height,
+	const long long frame_capacity,
+	const long long requested_frames,
+	const double fps) :
+		m_cache_path{cache_path},
+		m_temp_path{cache_path + "." + std::to_string(static_cast<long>(getpid())) + ".tmp"},
+		m_key{key},
+		m_fps{fps},
+		m_frame_width{frame_width},
+		m_frame_height{frame_height},
+		m_frame_capacity{frame_capacity},
+		m_requested_frames{requested_frames}
+{
+	EXCEPTION_ASSERT(frame_width > 0 && frame_height > 0 && frame_capacity > 0);
+
+	const std::string header{frame_cache_header(frame_width, frame_height, fps, key, requested_frames)};
+	m_header_bytes = header.size();
+
+	const unsigned long long record_bytes{sizeof(s_frame_marker) + static_cast<unsigned long long>(frame_width)*static_cast<unsigned long long>(frame_height)};
+	const unsigned long long cache_bytes{m_header_bytes + static_cast<unsigned long long>(frame_capacity)*record_bytes};
+
+	// leave the cache out if the disk can't hold it
+	const std::size_t dir_end{cache_path.find_last_of('/')};
+	const std::string cache_dir{dir_end == std::string::npos ? "." : (dir_end == 0 ? "/" : cache_path.substr(0, dir_end))};
+	struct statvfs dir_stats{};
+
+	if (statvfs(cache_dir.c_str(), &dir_stats) != 0 ||
+		static_cast<unsigned long long>(dir_stats.f_bavail)*static_cast<unsigned long long>(dir_stats.f_frsize) < cache_bytes)
+		return;
+
+	m_fd = open(m_temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (m_fd < 0)
+		return;
+
+	if (!write_all_at(m_fd, reinterpret_cast<const unsigned char*>(header.data()), m_header_bytes, 0))
+	{
+		close(m_fd);
+		m_fd = -1;
+		std::remove(m_temp_path.c_str());
+
+		return;
+	}
+
+	m_frames_present.resize(static_cast<std::size_t>(frame_capacity), false);
+}
+
+CvFrameCacheWriter::~CvFrameCacheWriter()
+{
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+		std::remove(m_temp_path.c_str());
+	}
+}
+
+bool CvFrameCacheWriter::WriteFrame(const long long frame_number, const cv::Mat &frame)
+{
+	if (m_fd < 0 || frame_number < 0 || m_write_failed.load())
+		return false;
+
+	if (frame_number >= m_frame_capacity)
+	{
+		m_frames_lost = true;
+
+		return false;
+	}
+
+	if (frame.type() != CV_8UC1 || frame.cols != m_frame_width || frame.rows != m_frame_height)
+		return false;
+
+	// one record: marker, then pixels
+	const std::size_t frame_bytes{static_cast<std::size_t>(m_frame_width)*static_cast<std::size_t>(m_frame_height)};
+	std::vector<unsigned char> record(sizeof(s_frame_marker) + frame_bytes);
+	std::memcpy(record.data(), s_frame_marker, sizeof(s_frame_marker));
+
+	cv::Mat record_frame{m_frame_height, m_frame_width, CV_8UC1, record.data() + sizeof(s_frame_marker)};
+	frame.copyTo(record_frame);
+
+	const off_t record_offset{static_cast<off_t>(m_header_bytes + static_cast<std::size_t>(frame_number)*record.size())};
+
+	if (!write_all_at(m_fd, record.data(), record.size(), record_offset))
+	{
+		m_write_failed = true;
+
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock{m_frames_mutex};
+	m_frames_present[static_cast<std::size_t>(frame_number)] = true;
+
+	return true;
+}
+
+void CvFrameCacheWriter::Finish(const bool complete)
+{
+	if (m_fd < 0)
+		return;
+
+	// frames held: the run of frames from frame 0 without gaps
+	long long frames_held{0};
+
+	{
+		std::lock_guard<std::mutex> lock{m_frames_mutex};
+
+		while (frames_held < m_frame_capacity && m_frames_present[static_cast<std::size_t>(frames_held)])
+			frames_held++;
+	}
+
+	// the cache must cover the expected range; it holds the whole video unless the video had more frames than estimated
+	bool publish{complete && !m_write_failed.load() && frames_held == m_frame_capacity};
+
+	if (publish)
+	{
+		const long long header_frames{m_requested_frames < 0 && !m_frames_lost.load() ? -1 : frames_held};
+		const std::string header{frame_cache_header(m_frame_width, m_frame_height, m_fps, m_key, header_frames)};
+		const std::size_t record_bytes{sizeof(s_frame_marker) + static_cast<std::size_t>(m_frame_width)*static_cast<std::size_t>(m_frame_height)};
+
+		publish = header.size() == m_header_bytes &&
+			write_all_at(m_fd, reinterpret_cast<const unsigned char*>(header.data()), m_header_bytes, 0) &&
+			ftruncate(m_fd, static_cast<off_t>(m_header_bytes + static_cast<std::size_t>(frames_held)*record_bytes)) == 0 &&
+			fsync(m_fd) == 0;
+	}
+
+	// publish or discard the file
+	close(m_fd);
+	m_fd = -1;
+
+	if (!publish || std::rename(m_temp_path.c_str(), m_cache_path.c_str()) != 0)
+		std::remove(m_temp_path.c_str());
+}
@@ -0,0 +1,125 @@
+// cache of a video's decoded frames (cropped and grayscale), so later passes over the video don't decode it again
+
+#ifndef CV_FRAME_CACHE_4470186_H
+#define CV_FRAME_CACHE_4470186_H
+
+//local headers
+#include "cv_frame_source.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//forward declarations
+
+
+////
+// frame cache file layout: a YUV4MPEG2 stream of mono frames ('Cmono'), so it can be read like any .y4m frame source
+// - the stream header carries the cache key ('XCVVIDKEY=<key>') and how many frames the cache holds ('XCVVIDFRAMES=<n>',
+//   -1 if it holds the whole video)
+// - frames start at frame 0 of the video with no gaps, and are the video's frames after cropping and grayscale conversion
+///
+
+/// get the key of a frame cache: identifies the video (path, size, modification time), the crop region, and the grayscale mode
+/// - 'decode_luma': frames are the luma plane of the decoded frames (otherwise channel 0 if 'vid_is_grayscale', otherwise
+///   a BGR->gray conversion)
+std::string cv_frame_cache_key(const std::string &vid_path, const cv::Rect &crop_region, const bool vid_is_grayscale, const bool decode_luma);
+
+/// open a frame cache as a frame source (returns false if there is no cache with this key holding 'min_frames' frames)
+/// - 'min_frames' < 0 means the cache must hold the whole video
+/// - the source's frames are already cropped (see CvFrameSource::source_crop)
+bool cv_open_frame_cache(const std::string &cache_path,
+	const std::string &key,
+	const cv::Rect &crop_region,
+	const long long min_frames,
+	CvFrameSource &source_output);
+
+////
+// writes a frame cache (thread-safe: frames may be written in any order by several threads)
+// - the cache is written to a temporary file that replaces the cache path in Finish(), so a reader never sees a partial cache
+// - frames are written with pwrite(), so running out of disk space discards the cache instead of faulting; the space for
+//   the expected frames is also checked up front
+///
+class CvFrameCacheWriter final
+{
+public:
+//constructors
+	/// default constructor: disabled
+	CvFrameCacheWriter() = delete;
+
+	/// normal constructor
+	/// - 'frame_capacity': number of frames expected in the requested range
+	/// - 'requested_frames' < 0 means the whole video ('frame_capacity' is then the video's estimated frame count)
+	/// - check IsOpen() afterward (the file can't be made, or there isn't disk space for it)
+	CvFrameCacheWriter(const std::string &cache_path,
+		const std::string &key,
+		const int frame_width,
+		const int frame_height,
+		const long long frame_capacity,
+		const long long requested_frames,
+		const double fps);
+
+	/// copy constructor: disabled
+	CvFrameCacheWriter(const CvFrameCacheWriter&) = delete;
+
+//destructor
+	/// discards the temporary file if the cache wasn't finished
+	~CvFrameCacheWriter();
+
+//overloaded operators
+	/// copy assignment operator: disabled
+	CvFrameCacheWriter& operator=(const CvFrameCacheWriter&) = delete;
+
+//member functions
+	/// report if frames can be written
+	bool IsOpen() const { return m_fd >= 0; }
+
+	/// write a frame (must be a single-channel 8-bit frame of the cache's size; returns false if it can't be stored)
+	bool WriteFrame(const long long frame_number, const cv::Mat &frame);
+
+	/// finish the cache
+	/// - 'complete': decoding was not stopped early
+	/// - the cache is published only if the frames written from frame 0 on, without gaps, cover the expected range (a frame
+	///   the decoder failed on leaves a gap); otherwise, or if a write failed, it is discarded
+	void Finish(const bool complete);
+
+private:
+//member variables
+	/// path of the finished cache
+	std::string m_cache_path{};
+	/// path the cache is written to
+	std::string m_temp_path{};
+	/// cache key
+	std::string m_key{};
+	/// frame rate of the video
+	double m_fps{0.0};
+	/// descriptor of the file being written (-1 if none)
+	int m_fd{-1};
+	/// frame width (pixels)
+	int m_frame_width{0};
+	/// frame height (pixels)
+	int m_frame_height{0};
+	/// number of frames expected
+	long long m_frame_capacity{0};
+	/// number of frames requested (< 0 means the whole video)
+	long long m_requested_frames{-1};
+	/// bytes of the stream header
+	std::size_t m_header_bytes{0};
+	/// which frames were written
+	std::vector<bool> m_frames_present{};
+	/// guards m_frames_present
+	std::mutex m_frames_mutex{};
+	/// if a frame past the expected range was dropped (the video had more frames than estimated)
+	std::atomic<bool> m_frames_lost{false};
+	/// if writing to the file failed (e.g. the disk is full)
+	std::atomic<bool> m_write_failed{false};
+};
+
+
+#endif	//header guard
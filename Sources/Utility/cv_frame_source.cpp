@@ -0,0 +1,403 @@
+// sources of frames: videos, directories of images, and raw frame files
+
+//paired header
+#include "cv_frame_source.h"
+
+//local headers
+#include "mapped_file.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+
+/// lowercase copy of a string
+static std::string to_lower(std::string text)
+{
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+
+	return text;
+}
+
+/// lowercase extension of a path (without the dot; empty if there is none)
+static std::string path_extension(const std::string &path)
+{
+	const std::size_t dot_pos{path.find_last_of('.')};
+	const std::size_t slash_pos{path.find_last_of("/\\")};
+
+	if (dot_pos == std::string::npos || (slash_pos != std::string::npos && dot_pos < slash_pos))
+		return std::string{};
+
+	return to_lower(path.substr(dot_pos + 1));
+}
+
+/// bytes in one raw frame (returns 0 if the frame size doesn't suit the pixel format)
+static std::size_t raw_frame_bytes(const int width, const int height, const CvRawPixelFormat pixel_format)
+{
+	if (width <= 0 || height <= 0)
+		return 0;
+
+	const std::size_t plane_bytes{static_cast<std::size_t>(width)*static_cast<std::size_t>(height)};
+
+	switch (pixel_format)
+	{
+		case CvRawPixelFormat::GRAY8 :
+			return plane_bytes;
+
+		case CvRawPixelFormat::BGR24 :
+			return plane_bytes*3;
+
+		// subsampled chroma planes are half the width (and height for 4:2:0), so odd sizes aren't supported
+		case CvRawPixelFormat::YUV420P :
+			return (width % 2 || height % 2) ? 0 : plane_bytes*3/2;
+
+		case CvRawPixelFormat::YUV422P :
+			return (width % 2) ? 0 : plane_bytes*2;
+
+		case CvRawPixelFormat::YUV444P :
+			return plane_bytes*3;
+
+		default :
+			return 0;
+	};
+}
+
+/// get a raw pixel format from its name (returns false if unknown)
+static bool raw_pixel_format(const std::string &name, CvRawPixelFormat &format_output)
+{
+	const std::string format_name{to_lower(name)};
+
+	if (format_name == "gray8" || format_name == "gray")
+		format_output = CvRawPixelFormat::GRAY8;
+	else if (format_name == "bgr24")
+		format_output = CvRawPixelFormat::BGR24;
+	else if (format_name == "yuv420p" || format_name == "i420")
+		format_output = CvRawPixelFormat::YUV420P;
+	else if (format_name == "yuv422p")
+		format_output = CvRawPixelFormat::YUV422P;
+	else if (format_name == "yuv444p")
+		format_output = CvRawPixelFormat::YUV444P;
+	else
+		return false;
+
+	return true;
+}
+
+/// open a directory of images as a frame source
+static bool open_image_sequence(const std::string &dir_path, CvFrameSource &source_output)
+{
+	static const std::vector<std::string> s_image_extensions{"png", "jpg", "jpeg", "bmp", "tif", "tiff", "pgm", "ppm"};
+
+	std::vector<std::string> files{};
+	cv::glob(dir_path + "/*", files, false);
+
+	auto image_paths{std::make_shared<std::vector<std::string>>()};
+	image_paths->reserve(files.size());
+
+	for (auto &file : files)
+	{
+		if (std::find(s_image_extensions.begin(), s_image_extensions.end(), path_extension(file)) != s_image_extensions.end())
+			image_paths->emplace_back(std::move(file));
+	}
+
+	// frame order is name order (e.g. 'frame_00001.png', 'frame_00002.png', ...)
+	std::sort(image_paths->begin(), image_paths->end());
+
+	if (image_paths->empty())
+	{
+		std::cerr << "No images found in directory: " << dir_path << '\n';
+
+		return false;
+	}
+
+	// all images are assumed to be the size of the first
+	const cv::Mat first_image{cv::imread(image_paths->front(), cv::IMREAD_UNCHANGED)};
+
+	if (first_image.empty())
+	{
+		std::cerr << "Could not read image: " << image_paths->front() << '\n';
+
+		return false;
+	}
+
+	source_output.type = CvFrameSourceType::IMAGE_SEQUENCE;
+	source_output.path = dir_path;
+	source_output.frame_width = first_image.cols;
+	source_output.frame_height = first_image.rows;
+	source_output.frame_count = static_cast<long long>(image_paths->size());
+	source_output.fps = 0.0;
+	source_output.image_paths = std::move(image_paths);
+	source_output.raw_frames = nullptr;
+
+	return true;
+}
+
+/// finish opening a raw frame source once the frames have been located
+static bool set_raw_frame_source(const std::string &path, std::shared_ptr<CvRawFrames> raw_frames, const double fps, CvFrameSource &source_output)
+{
+	if (raw_frames->frame_offsets.empty())
+	{
+		std::cerr << "No frames found in raw frame file: " << path << '\n';
+
+		return false;
+	}
+
+	source_output.type = CvFrameSourceType::RAW_FRAMES;
+	source_output.path = path;
+	source_output.frame_width = raw_frames->frame_width;
+	source_output.frame_height = raw_frames->frame_height;
+	source_output.frame_count = static_cast<long long>(raw_frames->frame_offsets.size());
+	source_output.fps = fps;
+	source_output.image_paths = nullptr;
+	source_output.raw_frames = std::move(raw_frames);
+
+	return true;
+}
+
+/// open a YUV4MPEG2 file as a frame source
+static bool open_y4m(const std::string &path, CvFrameSource &source_output)
+{
+	auto raw_frames{std::make_shared<CvRawFrames>()};
+	raw_frames->file = std::make_shared<const MappedFile>(path);
+
+	const unsigned char *data{raw_frames->file->Data()};
+	const std::size_t size{raw_frames->file->Size()};
+
+	// stream header: 'YUV4MPEG2 W<width> H<height> F<num>:<den> ... C<color space>\n'
+	const unsigned char *header_end{std::find(data, data + size, static_cast<unsigned char>('\n'))};
+
+	if (header_end == data + size)
+	{
+		std::cerr << "Invalid y4m header: " << path << '\n';
+
+		return false;
+	}
+
+	std::istringstream header{std::string{reinterpret_cast<const char*>(data), reinterpret_cast<const char*>(header_end)}};
+	std::string parameter{};
+	double fps{0.0};
+	raw_frames->pixel_format = CvRawPixelFormat::YUV420P;
+
+	header >> parameter;
+
+	if (parameter != "YUV4MPEG2")
+	{
+		std::cerr << "Invalid y4m header: " << path << '\n';
+
+		return false;
+	}
+
+	while (header >> parameter)
+	{
+		if (parameter[0] == 'W')
+			raw_frames->frame_width = std::atoi(parameter.c_str() + 1);
+		else if (parameter[0] == 'H')
+			raw_frames->frame_height = std::atoi(parameter.c_str() + 1);
+		else if (parameter[0] == 'F')
+		{
+			const std::size_t colon_pos{parameter.find(':')};
+
+			if (colon_pos != std::string::npos && std::atof(parameter.c_str() + colon_pos + 1) > 0.0)
+				fps = std::atof(parameter.c_str() + 1) / std::atof(parameter.c_str() + colon_pos + 1);
+		}
+		else if (parameter[0] == 'C')
+		{
+			// all 4:2:0 chroma sitings share the same plane layout
+			if (parameter.compare(0, 4, "C420") == 0)
+				raw_frames->pixel_format = CvRawPixelFormat::YUV420P;
+			else if (parameter == "C422")
+				raw_frames->pixel_format = CvRawPixelFormat::YUV422P;
+			else if (parameter == "C444")
+				raw_frames->pixel_format = CvRawPixelFormat::YUV444P;
+			else if (parameter == "Cmono")
+				raw_frames->pixel_format = CvRawPixelFormat::GRAY8;
+			else
+			{
+				std::cerr << "Unsupported y4m color space '" << parameter.substr(1) << "': " << path << '\n';
+
+				return false;
+			}
+		}
+	}
+
+	const std::size_t frame_bytes{raw_frame_bytes(raw_frames->frame_width, raw_frames->frame_height, raw_frames->pixel_format)};
+
+	if (frame_bytes == 0)
+	{
+		std::cerr << "Unsupported y4m frame size: " << path << '\n';
+
+		return false;
+	}
+
+	// frames: 'FRAME[ parameters]\n' followed by the frame's planes
+	std::size_t offset{static_cast<std::size_t>(header_end - data) + 1};
+
+	while (offset + 5 < size && std::equal(data + offset, data + offset + 5, "FRAME"))
+	{
+		const unsigned char *frame_header_end{std::find(data + offset, data + size, static_cast<unsigned char>('\n'))};
+		const std::size_t frame_offset{static_cast<std::size_t>(frame_header_end - data) + 1};
+
+		// a truncated last frame is ignored
+		if (frame_header_end == data + size || frame_offset + frame_bytes > size)
+			break;
+
+		raw_frames->frame_offsets.emplace_back(frame_offset);
+		offset = frame_offset + frame_bytes;
+	}
+
+	return set_raw_frame_source(path, std::move(raw_frames), fps, source_output);
+}
+
+/// open a file of headerless raw frames as a frame source ('raw_format' is 'WxH:fmt')
+static bool open_raw_frames(const std::string &path, const std::string &raw_format, CvFrameSource &source_output)
+{
+	auto raw_frames{std::make_shared<CvRawFrames>()};
+
+	// parse the format
+	const std::size_t x_pos{raw_format.find('x')};
+	const std::size_t colon_pos{raw_format.find(':')};
+
+	if (x_pos == std::string::npos ||
+		colon_pos == std::string::npos ||
+		colon_pos < x_pos ||
+		!raw_pixel_format(raw_format.substr(colon_pos + 1), raw_frames->pixel_format))
+	{
+		std::cerr << "Invalid raw frame format '" << raw_format << "' (expected 'WxH:fmt')\n";
+
+		return false;
+	}
+
+	raw_frames->frame_width = std::atoi(raw_format.substr(0, x_pos).c_str());
+	raw_frames->frame_height = std::atoi(raw_format.substr(x_pos + 1, colon_pos - x_pos - 1).c_str());
+
+	const std::size_t frame_bytes{raw_frame_bytes(raw_frames->frame_width, raw_frames->frame_height, raw_frames->pixel_format)};
+
+	if (frame_bytes == 0)
+	{
+		std::cerr << "Unsupported raw frame size '" << raw_format << "'\n";
+
+		return false;
+	}
+
+	// frames are stored back to back
+	raw_frames->file = std::make_shared<const MappedFile>(path);
+	const std::size_t size{raw_frames->file->Size()};
+
+	if (size % frame_bytes)
+		std::cerr << "warning, raw frame file doesn't hold a whole number of frames (the partial frame is ignored): " << path << '\n';
+
+	raw_frames->frame_offsets.reserve(size / frame_bytes);
+
+	for (std::size_t offset{0}; offset + frame_bytes <= size; offset += frame_bytes)
+		raw_frames->frame_offsets.emplace_back(offset);
+
+	return set_raw_frame_source(path, std::move(raw_frames), 0.0, source_output);
+}
+
+/// open a video as a frame source
+static bool open_video(const std::string &path, CvFrameSource &source_output)
+{
+	cv::VideoCapture vid{path};
+
+	if (!vid.isOpened())
+	{
+		std::cerr << "Video file not detected: " << path << '\n';
+
+		return false;
+	}
+
+	source_output.type = CvFrameSourceType::VIDEO;
+	source_output.path = path;
+	source_output.frame_width = static_cast<int>(vid.get(cv::CAP_PROP_FRAME_WIDTH));
+	source_output.frame_height = static_cast<int>(vid.get(cv::CAP_PROP_FRAME_HEIGHT));
+	source_output.frame_count = static_cast<long long>(vid.get(cv::CAP_PROP_FRAME_COUNT));
+	source_output.fps = vid.get(cv::CAP_PROP_FPS);
+	source_output.image_paths = nullptr;
+	source_output.raw_frames = nullptr;
+
+	return source_output.frame_count > 0;
+}
+
+bool cv_open_frame_source(const std::string &path, const std::string &raw_format, CvFrameSource &source_output)
+{
+	struct stat file_stats{};
+
+	if (stat(path.c_str(), &file_stats) == 0 && S_ISDIR(file_stats.st_mode))
+		return open_image_sequence(path, source_output);
+	else if (path_extension(path) == "y4m")
+		return open_y4m(path, source_output);
+	else if (!raw_format.empty())
+		return open_raw_frames(path, raw_format, source_output);
+	else
+		return open_video(path, source_output);
+}
+
+cv::Mat cv_raw_frame(const CvRawFrames &raw_frames, const long long frame, const bool luma_only)
+{
+	if (frame < 0 || frame >= static_cast<long long>(raw_frames.frame_offsets.size()))
+		return cv::Mat{};
+
+	const int width{raw_frames.frame_width};
+	const int height{raw_frames.frame_height};
+
+	// the mapping is read-only, but views are handed out as plain Mats (see header)
+	unsigned char *frame_data{const_cast<unsigned char*>(raw_frames.file->Data()) + raw_frames.frame_offsets[frame]};
+
+	if (raw_frames.pixel_format == CvRawPixelFormat::GRAY8)
+		return cv::Mat{height, width, CV_8UC1, frame_data};
+	else if (raw_frames.pixel_format == CvRawPixelFormat::BGR24)
+		return cv::Mat{height, width, CV_8UC3, frame_data};
+
+	// YUV: the luma plane comes first
+	cv::Mat luma{height, width, CV_8UC1, frame_data};
+
+	if (luma_only)
+		return luma;
+
+	cv::Mat bgr_frame{};
+
+	if (raw_frames.pixel_format == CvRawPixelFormat::YUV420P)
+	{
+		// the planes of an I420 frame stacked as one (3/2 x height) x width image
+		cv::cvtColor(cv::Mat{height*3/2, width, CV_8UC1, frame_data}, bgr_frame, cv::COLOR_YUV2BGR_I420);
+
+		return bgr_frame;
+	}
+
+	// 4:2:2 and 4:4:4: merge full-size planes (chroma upsampled if needed), then convert
+	const int chroma_width{raw_frames.pixel_format == CvRawPixelFormat::YUV422P ? width/2 : width};
+	const std::size_t plane_bytes{static_cast<std::size_t>(width)*static_cast<std::size_t>(height)};
+	const std::size_t chroma_bytes{static_cast<std::size_t>(chroma_width)*static_cast<std::size_t>(height)};
+
+	std::vector<cv::Mat> planes{luma,
+		cv::Mat{height, chroma_width, CV_8UC1, frame_data + plane_bytes},
+		cv::Mat{height, chroma_width, CV_8UC1, frame_data + plane_bytes + chroma_bytes}};
+
+	if (chroma_width != width)
+	{
+		for (std::size_t plane_index{1}; plane_index < planes.size(); plane_index++)
+		{
+			cv::Mat upsampled_plane{};
+			cv::resize(planes[plane_index], upsampled_plane, cv::Size{width, height}, 0, 0, cv::INTER_NEAREST);
+			planes[plane_index] = std::move(upsampled_plane);
+		}
+	}
+
+	cv::Mat yuv_frame{};
+	cv::merge(planes, yuv_frame);
+	cv::cvtColor(yuv_frame, bgr_frame, cv::COLOR_YUV2BGR);
+
+	return bgr_frame;
+}
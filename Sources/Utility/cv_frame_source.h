@@ -0,0 +1,96 @@
+// sources of frames: videos, directories of images, and raw frame files
+
+#ifndef CV_FRAME_SOURCE_5518204_H
+#define CV_FRAME_SOURCE_5518204_H
+
+//local headers
+#include "mapped_file.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>
+
+//standard headers
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+//forward declarations
+
+
+/// kinds of frame sources
+enum class CvFrameSourceType
+{
+	VIDEO,
+	IMAGE_SEQUENCE,
+	RAW_FRAMES
+};
+
+/// pixel layouts of raw frames (8 bits per sample)
+enum class CvRawPixelFormat
+{
+	GRAY8,
+	BGR24,
+	YUV420P,
+	YUV422P,
+	YUV444P
+};
+
+////
+// raw frames stored back to back in a memory-mapped file
+// - frames are read straight from the mapping, so reading a frame costs no decode and (for gray8/bgr24, or the luma
+//   plane of YUV frames) no copy
+///
+struct CvRawFrames
+{
+	/// the mapped file (must outlive any frame views into it)
+	std::shared_ptr<const MappedFile> file{};
+	/// frame width (pixels)
+	int frame_width{0};
+	/// frame height (pixels)
+	int frame_height{0};
+	/// pixel layout of each frame
+	CvRawPixelFormat pixel_format{CvRawPixelFormat::GRAY8};
+	/// byte offset of each frame in the file
+	std::vector<std::size_t> frame_offsets{};
+};
+
+/// a source of frames, opened once and shared by the frame generators reading it
+struct CvFrameSource
+{
+	/// kind of source
+	CvFrameSourceType type{CvFrameSourceType::VIDEO};
+	/// path the source was opened from
+	std::string path{};
+	/// frame width (pixels)
+	int frame_width{0};
+	/// frame height (pixels)
+	int frame_height{0};
+	/// number of frames (estimated by the container for videos)
+	long long frame_count{0};
+	/// frames per second (0 if unknown)
+	double fps{0.0};
+	/// image files in frame order (image sequences only)
+	std::shared_ptr<const std::vector<std::string>> image_paths{};
+	/// mapped frames (raw frame files only)
+	std::shared_ptr<const CvRawFrames> raw_frames{};
+	/// region of the original frames these frames were cut from (empty unless the frames are pre-cropped, e.g. a frame cache)
+	cv::Rect source_crop{};
+};
+
+/// open a frame source
+/// - a directory is an image sequence: its image files (png, jpg, jpeg, bmp, tif, tiff, pgm, ppm) sorted by name
+/// - a '.y4m' file is a YUV4MPEG2 stream of raw frames (420, 422, 444, and mono color spaces)
+/// - with a 'raw_format' of 'WxH:fmt' (fmt: gray8, bgr24, yuv420p, yuv422p, yuv444p), the file holds headerless raw frames
+/// - anything else is opened as a video
+/// - returns false if the source can't be opened or has no frames
+bool cv_open_frame_source(const std::string &path, const std::string &raw_format, CvFrameSource &source_output);
+
+/// get a raw frame
+/// - gray8 and bgr24 frames are views into the mapping
+/// - YUV frames are converted to BGR (new buffers), or with 'luma_only' reduced to their luma plane (a view into the mapping)
+/// - views are read-only: writing into them faults, so clone frames that will be modified
+cv::Mat cv_raw_frame(const CvRawFrames &raw_frames, const long long frame, const bool luma_only);
+
+
+#endif	//header guard
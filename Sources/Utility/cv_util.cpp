@@ -10,29 +10,12 @@
 #include <opencv2/opencv.hpp>	//for video manipulation (mainly)
 
 //standard headers
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 
-struct BorderedChunk
-{
-	/// x-coord of chunk within original 2-d matrix
-	int corner_x{};
-	/// y-coord of chunk within original 2-d matrix
-	int corner_y{};
-	/// width of chunk
-	int chunk_width{};
-	/// height of chunk
-	int chunk_height{};
-	/// x-coord of pre-buffer chunk within original 2-d matrix
-	int original_x{};
-	/// y-coord of pre-buffer chunk within original 2-d matrix
-	int original_y{};
-	/// width of pre-buffer chunk
-	int original_width{};
-	/// height of pre-buffer chunk
-	int original_height{};
-};
-
 static bool get_bordered_chunks(
 	std::vector<BorderedChunk> &ret,
 	const int original_width,
@@ -52,6 +35,11 @@ static bool get_bordered_chunks(
 		vertical_buffer_pixels < 0)
 		return false;
 
+	// every chunk must be at least one pixel wide and tall
+	if (col_divisor > original_width ||
+		row_divisor > original_height)
+		return false;
+
 	// columns and rows of chunks
 	int new_col_width = original_width / col_divisor;
 	int new_row_height = original_height / row_divisor;
@@ -137,43 +125,113 @@ static bool get_bordered_chunks(
 }
 
 
+bool cv_chunk_grid(
+	const int num_chunks,
+	const int mat_width,
+	const int mat_height,
+	const int max_rows,
+	int &col_divisor_output,
+	int &row_divisor_output)
+{
+	if (num_chunks <= 0 || mat_width <= 0 || mat_height <= 0)
+		return false;
+
+	// prefer more rows: row strips keep each chunk's rows contiguous
+	int row_limit{max_rows > 0 ? std::min(max_rows, num_chunks) : num_chunks};
+
+	for (int rows{row_limit}; rows >= 1; rows--)
+	{
+		if (num_chunks % rows != 0)
+			continue;
+
+		if (rows > mat_height || num_chunks / rows > mat_width)
+			continue;
+
+		col_divisor_output = num_chunks / rows;
+		row_divisor_output = rows;
+
+		return true;
+	}
+
+	return false;
+}
+
+bool cv_chunk_plan(
+	ChunkPlan &plan_output,
+	const int mat_width,
+	const int mat_height,
+	const int col_divisor,
+	const int row_divisor,
+	int horizontal_buffer_pixels/* = 0*/,
+	int vertical_buffer_pixels/* = 0*/)
+{
+	// figure out location and size of all chunks within original 2-d Mat matrix
+	// if this fails then inputs are invalid
+	std::vector<BorderedChunk> chunks{};
+	if (!get_bordered_chunks(chunks, mat_width, mat_height, col_divisor, row_divisor, horizontal_buffer_pixels, vertical_buffer_pixels))
+		return false;
+
+	// sanity check
+	if (chunks.size() != col_divisor*row_divisor)
+		return false;
+
+	plan_output = ChunkPlan{mat_width, mat_height, col_divisor, row_divisor, std::move(chunks)};
+
+	return true;
+}
+
 bool cv_mat_to_chunks(
 		const cv::Mat &mat_input,
 		std::vector<std::unique_ptr<cv::Mat>> &chunks_output,
 		const int col_divisor,
 		const int row_divisor,
 		int horizontal_buffer_pixels/* = 0*/,
-		int vertical_buffer_pixels/* = 0*/)
+		int vertical_buffer_pixels/* = 0*/,
+		const bool share_data/* = false*/)
 {
-	// https://answers.opencv.org/question/53694/divide-an-image-into-lower-regions/
 	// check that input Mat has content
 	if (!mat_input.data || mat_input.empty())
 		return false;
 
-	// must be more than zero chunks
-	if (!row_divisor || !col_divisor)
+	ChunkPlan chunk_plan{};
+	if (!cv_chunk_plan(chunk_plan, mat_input.cols, mat_input.rows, col_divisor, row_divisor, horizontal_buffer_pixels, vertical_buffer_pixels))
 		return false;
 
-	// sanity check
-	if (chunks_output.size() != 0)
+	return cv_mat_to_chunks(mat_input, chunks_output, chunk_plan, share_data);
+}
+
+bool cv_mat_to_chunks(
+		const cv::Mat &mat_input,
+		std::vector<std::unique_ptr<cv::Mat>> &chunks_output,
+		const ChunkPlan &chunk_plan,
+		const bool share_data/* = false*/)
+{
+	// https://answers.opencv.org/question/53694/divide-an-image-into-lower-regions/
+	// check that input Mat has content
+	if (!mat_input.data || mat_input.empty())
 		return false;
 
-	// figure out location and size of all chunks within original 2-d Mat matrix
-	// if this fails then inputs are invalid
-	std::vector<BorderedChunk> chunks{};
-	if (!get_bordered_chunks(chunks, mat_input.cols, mat_input.rows, col_divisor, row_divisor, horizontal_buffer_pixels, vertical_buffer_pixels))
+	// must be more than zero chunks, laid out for this Mat
+	if (chunk_plan.chunks.empty() ||
+		mat_input.cols != chunk_plan.mat_width ||
+		mat_input.rows != chunk_plan.mat_height)
 		return false;
 
 	// sanity check
-	if (chunks.size() != col_divisor*row_divisor)
+	if (chunks_output.size() != 0)
 		return false;
 
 	// create all the actual chunks
-	chunks_output.reserve(chunks.size());
+	chunks_output.reserve(chunk_plan.chunks.size());
 
-	for (const auto& chunk : chunks)
+	for (const auto& chunk : chunk_plan.chunks)
 	{
-		chunks_output.emplace_back(std::make_unique<cv::Mat>(mat_input(cv::Rect(chunk.corner_x, chunk.corner_y, chunk.chunk_width, chunk.chunk_height)).clone()));
+		cv::Mat chunk_view{mat_input(cv::Rect(chunk.corner_x, chunk.corner_y, chunk.chunk_width, chunk.chunk_height))};
+
+		if (share_data)
+			chunks_output.emplace_back(std::make_unique<cv::Mat>(chunk_view));
+		else
+			chunks_output.emplace_back(std::make_unique<cv::Mat>(chunk_view.clone()));
 	}
 
 	return true;
@@ -193,50 +251,63 @@ bool cv_mat_from_chunks(
 	if (!(row_divisor*col_divisor) || row_divisor*col_divisor != chunks_input.size())
 		return false;
 
-	// figure out location and size of all chunks within original 2-d Mat matrix
-	// if this fails then inputs are invalid
-	std::vector<BorderedChunk> chunks{};
-	if (!get_bordered_chunks(chunks, final_width, final_height, col_divisor, row_divisor, horizontal_buffer_pixels, vertical_buffer_pixels))
+	ChunkPlan chunk_plan{};
+	if (!cv_chunk_plan(chunk_plan, final_width, final_height, col_divisor, row_divisor, horizontal_buffer_pixels, vertical_buffer_pixels))
 		return false;
 
-	// sanity check
-	if (chunks.size() != chunks_input.size())
+	// assemble into a new Mat so the caller's Mat is left alone on failure
+	cv::Mat temp_output{};
+	if (!cv_mat_from_chunks(temp_output, chunks_input, chunk_plan))
 		return false;
 
-	// initialize temp Mat with expected dimensions
-	if (!chunks_input.front().data ||
-		chunks_input.front().empty())
+	mat_output = std::move(temp_output);
+
+	return true;
+}
+
+bool cv_mat_from_chunks(
+	cv::Mat &mat_output,
+	const std::vector<cv::Mat> &chunks_input,
+	const ChunkPlan &chunk_plan)
+{
+	// must be expected number of chunks (and nonzero)
+	if (chunk_plan.chunks.empty() || chunk_plan.chunks.size() != chunks_input.size())
 		return false;
 
-	cv::Mat temp_output(final_height, final_width, chunks_input.front().type());
+	// validate chunks before writing anything
+	for (const auto &input_chunk : chunks_input)
+	{
+		if (!input_chunk.data ||
+			input_chunk.empty() ||
+			input_chunk.type() != chunks_input.front().type())
+			return false;
+	}
+
+	// initialize output Mat with expected dimensions (no-op if it already has them)
+	mat_output.create(chunk_plan.mat_height, chunk_plan.mat_width, chunks_input.front().type());
 
 	// https://stackoverflow.com/questions/33239669/opencv-how-to-merge-two-images?noredirect=1&lq=1
-	// copy chunks directly into temp Mat
-	for (std::size_t chunk_index{0}; chunk_index < chunks.size(); ++chunk_index)
+	// copy chunks directly into output Mat
+	for (std::size_t chunk_index{0}; chunk_index < chunk_plan.chunks.size(); ++chunk_index)
 	{
-		if (!chunks_input[chunk_index].data ||
-			chunks_input[chunk_index].empty())
-			return false;
+		const BorderedChunk &chunk{chunk_plan.chunks[chunk_index]};
 
 		// copy non-buffered component of input chunk into intended location in output Mat
-		// https://stackoverflow.com/questions/33239669/opencv-how-to-merge-two-images?noredirect=1&lq=1
 		const auto &input_chunk = chunks_input[chunk_index](cv::Rect(
-				chunks[chunk_index].original_x - chunks[chunk_index].corner_x,
-				chunks[chunk_index].original_y - chunks[chunk_index].corner_y,
-				chunks[chunk_index].original_width,
-				chunks[chunk_index].original_height
+				chunk.original_x - chunk.corner_x,
+				chunk.original_y - chunk.corner_y,
+				chunk.original_width,
+				chunk.original_height
 			));
 
-		input_chunk.copyTo(temp_output(cv::Rect(
-				chunks[chunk_index].original_x,
-				chunks[chunk_index].original_y,
-				chunks[chunk_index].original_width,
-				chunks[chunk_index].original_height
+		input_chunk.copyTo(mat_output(cv::Rect(
+				chunk.original_x,
+				chunk.original_y,
+				chunk.original_width,
+				chunk.original_height
 			)));
 	}
 
-	mat_output = std::move(temp_output);
-
 	return true;
 }
 
@@ -283,12 +354,160 @@ bool cv_mat_from_std_vector_uchar(cv::Mat &mat_output, const std::vector<unsigne
 	return true;
 }
 
+bool cv_mats_to_channel_stack(const std::vector<cv::Mat> &mats_input, cv::Mat &mat_output)
+{
+	if (mats_input.empty())
+		return false;
+
+	for (const auto &mat : mats_input)
+	{
+		if (!mat.data || mat.empty())
+			return false;
+
+		if (mat.size() != mats_input.front().size() || mat.depth() != mats_input.front().depth())
+			return false;
+	}
+
+	// nothing to stack
+	if (mats_input.size() == 1)
+	{
+		mat_output = mats_input.front();
+
+		return true;
+	}
+
+	// merge handles multi-channel inputs by appending all their channels in order
+	cv::merge(mats_input, mat_output);
+
+	return true;
+}
+
+bool cv_mats_from_channel_stack(const cv::Mat &mat_input, const int num_mats, std::vector<cv::Mat> &mats_output)
+{
+	if (!mat_input.data || mat_input.empty() || num_mats <= 0)
+		return false;
+
+	// each output Mat gets an equal share of the channels
+	if (mat_input.channels() % num_mats != 0)
+		return false;
+
+	const int channels_per_mat{mat_input.channels() / num_mats};
+
+	mats_output.clear();
+	mats_output.reserve(num_mats);
+
+	// nothing to split
+	if (num_mats == 1)
+	{
+		mats_output.emplace_back(mat_input);
+
+		return true;
+	}
+
+	std::vector<cv::Mat> single_channels{};
+	cv::split(mat_input, single_channels);
+
+	for (int mat_index{0}; mat_index < num_mats; mat_index++)
+	{
+		mats_output.emplace_back();
+
+		cv::merge(std::vector<cv::Mat>{single_channels.begin() + mat_index*channels_per_mat,
+				single_channels.begin() + (mat_index + 1)*channels_per_mat},
+			mats_output.back());
+	}
+
+	return true;
+}
+
 std::string get_fourcc_code_str(int x)
 {
 	// https://answers.opencv.org/question/77558/get-fourcc-after-openning-a-video-file/
 	return cv::format("%c%c%c%c", x & 255, (x >> 8) & 255, (x >> 16) & 255, (x >> 24) & 255);
 }
 
+bool cv_vid_keyframes(const std::string &vid_path,
+	const long long frame_limit,
+	std::vector<long long> &keyframes_output,
+	long long *frames_probed_output)
+{
+	keyframes_output.clear();
+
+	if (frames_probed_output)
+		*frames_probed_output = 0;
+
+#if (CV_VERSION_MAJOR > 4) || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+	cv::VideoCapture vid{vid_path, cv::CAP_FFMPEG};
+
+	if (!vid.isOpened())
+		return false;
+
+	// raw mode: grab() only demuxes packets, and each packet reports if it is a keyframe
+	if (!vid.set(cv::CAP_PROP_FORMAT, -1))
+		return false;
+
+	// packets arrive in decode order, which differs from display order with B-frames, so keyframes are numbered by
+	//   their presentation timestamps (in frames, relative to the earliest packet) like the backend numbers frames when
+	//   seeking; packet indices are the fallback if timestamps aren't reported
+	std::vector<long long> keyframe_timestamps{};
+	long long first_timestamp{std::numeric_limits<long long>::max()};
+	bool have_timestamps{true};
+	long long frame_index{0};
+
+	for (; frame_limit <= 0 || frame_index < frame_limit; frame_index++)
+	{
+		if (!vid.grab())
+			break;
+
+#if (CV_VERSION_MAJOR > 4) || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+		const double timestamp{vid.get(cv::CAP_PROP_PTS)};
+#else
+		const double timestamp{-1.0};
+#endif
+
+		if (timestamp < 0)
+			have_timestamps = false;
+		else
+			first_timestamp = std::min(first_timestamp, static_cast<long long>(std::llround(timestamp)));
+
+		if (vid.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0)
+		{
+			keyframes_output.emplace_back(frame_index);
+			keyframe_timestamps.emplace_back(static_cast<long long>(std::llround(timestamp)));
+		}
+	}
+
+	if (have_timestamps)
+	{
+		for (std::size_t keyframe{0}; keyframe < keyframes_output.size(); keyframe++)
+			keyframes_output[keyframe] = keyframe_timestamps[keyframe] - first_timestamp;
+
+		std::sort(keyframes_output.begin(), keyframes_output.end());
+		keyframes_output.erase(std::unique(keyframes_output.begin(), keyframes_output.end()), keyframes_output.end());
+	}
+
+	if (frames_probed_output)
+		*frames_probed_output = frame_index;
+
+	return !keyframes_output.empty();
+#else
+	(void)vid_path;
+	(void)frame_limit;
+	(void)frames_probed_output;
+
+	return false;
+#endif
+}
+
+bool cv_open_video(cv::VideoCapture &vid, const std::string &vid_path, const int decoder_threads)
+{
+#if (CV_VERSION_MAJOR > 4) || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+	// backends that don't support the property fail to open with it, so try again without it
+	if (decoder_threads > 0 && vid.open(vid_path, cv::CAP_ANY, std::vector<int>{cv::CAP_PROP_N_THREADS, decoder_threads}))
+		return true;
+#endif
+
+	return vid.open(vid_path);
+}
 
 
 
@@ -9,16 +9,85 @@
 #include <opencv2/opencv.hpp>   //for video manipulation (mainly)
 
 //standard headers
+#include <string>
 #include <vector>
 
 //forward declarations
 
 
+/// location of one chunk within a 2-d matrix (see get_bordered_chunks())
+struct BorderedChunk
+{
+	/// x-coord of chunk within original 2-d matrix
+	int corner_x{};
+	/// y-coord of chunk within original 2-d matrix
+	int corner_y{};
+	/// width of chunk
+	int chunk_width{};
+	/// height of chunk
+	int chunk_height{};
+	/// x-coord of pre-buffer chunk within original 2-d matrix
+	int original_x{};
+	/// y-coord of pre-buffer chunk within original 2-d matrix
+	int original_y{};
+	/// width of pre-buffer chunk
+	int original_width{};
+	/// height of pre-buffer chunk
+	int original_height{};
+};
+
+/// chunk layout for splitting and reassembling Mats of one size
+/// - frame geometry doesn't change within a pipeline, so compute the plan once and share it between the splitting and
+///  stitching sides
+struct ChunkPlan
+{
+	/// width of the whole Mat
+	int mat_width{};
+	/// height of the whole Mat
+	int mat_height{};
+	/// number of columns of chunks
+	int col_divisor{};
+	/// number of rows of chunks
+	int row_divisor{};
+	/// chunks laid out [col1 elements][col2 elements][col3 elements]
+	std::vector<BorderedChunk> chunks{};
+};
+
+////
+// compute the layout of row_divisor*col_divisor chunks of a mat_width x mat_height Mat
+// returns false if the inputs are invalid
+///
+bool cv_chunk_plan(
+	ChunkPlan &plan_output,
+	const int mat_width,
+	const int mat_height,
+	const int col_divisor,
+	const int row_divisor,
+	int horizontal_buffer_pixels = 0,
+	int vertical_buffer_pixels = 0);
+
+////
+// pick a grid of col_divisor x row_divisor chunks for splitting a width x height Mat into num_chunks chunks
+// - uses the largest number of rows that divides num_chunks and is at most max_rows (<= 0 means num_chunks, i.e. one
+//  horizontal strip per chunk), and that leaves every chunk at least one pixel wide and tall
+// - row strips are contiguous runs of whole Mat rows, so copying and scanning them is cheaper than column strips
+// returns false if no grid fits the Mat
+///
+bool cv_chunk_grid(
+	const int num_chunks,
+	const int mat_width,
+	const int mat_height,
+	const int max_rows,
+	int &col_divisor_output,
+	int &row_divisor_output);
+
 ////
 // split Mat into row_divisor*col_divisor chunks
 // output chunks are laid out [col1 elements][col2 elements][col3 elements] in vector
 // last chunks in each row or column will be larger than others if Mat dimensions don't divide perfectly
 // chunk-to-final-mat alignment is defined by get_bordered_chunks()
+// if share_data is set, chunks are views into the input Mat's buffer (refcounted, so the buffer lives until the last
+//  chunk is released); only use this if nothing writes to the chunks or the input
 ///
 bool cv_mat_to_chunks(
 	const cv::Mat &mat_input,
@@ -26,7 +95,15 @@ bool cv_mat_to_chunks(
 	const int col_divisor,
 	const int row_divisor,
 	int horizontal_buffer_pixels = 0,
-	int vertical_buffer_pixels = 0);
+	int vertical_buffer_pixels = 0,
+	const bool share_data = false);
+
+/// split Mat into chunks with a precomputed plan (the Mat must have the plan's dimensions)
+bool cv_mat_to_chunks(
+	const cv::Mat &mat_input,
+	std::vector<std::unique_ptr<cv::Mat>> &chunks_output,
+	const ChunkPlan &chunk_plan,
+	const bool share_data = false);
 
 ////
 // reassemble Mat from Mat chunks
@@ -44,15 +121,53 @@ bool cv_mat_from_chunks(
 	int horizontal_buffer_pixels = 0,
 	int vertical_buffer_pixels = 0);
 
+////
+// reassemble Mat from Mat chunks with a precomputed plan
+// chunks are written straight into mat_output, which keeps its buffer if it already has the plan's size and the chunks'
+// type (otherwise it is reallocated); don't pass a Mat whose buffer is shared with something that must not change
+///
+bool cv_mat_from_chunks(
+	cv::Mat &mat_output,
+	const std::vector<cv::Mat> &chunks_input,
+	const ChunkPlan &chunk_plan);
+
 /// convert Mat to std::vector<unsigned char>
 bool cv_mat_to_std_vector_uchar(const cv::Mat &mat_input, std::vector<unsigned char> &vec_output);
 
 /// convert Mat from std::vector<unsigned char>
 bool cv_mat_from_std_vector_uchar(cv::Mat &mat_output, const std::vector<unsigned char> &vec_input, const int rows, const int channels);
 
+////
+// stack Mats with the same size and depth into one Mat by appending their channels
+// output channels are laid out [mat1 channels][mat2 channels][mat3 channels]
+///
+bool cv_mats_to_channel_stack(const std::vector<cv::Mat> &mats_input, cv::Mat &mat_output);
+
+////
+// split a channel-stacked Mat into num_mats Mats with the same number of channels each
+// inverse of cv_mats_to_channel_stack()
+///
+bool cv_mats_from_channel_stack(const cv::Mat &mat_input, const int num_mats, std::vector<cv::Mat> &mats_output);
+
 /// get fourcc code from integer (video format code used by OpenCV)
 std::string get_fourcc_code_str(int x);
 
+/// find the keyframes of a video among its first 'frame_limit' frames (<= 0 means all frames)
+/// - reads the compressed packets without decoding them (needs the FFmpeg backend and OpenCV >= 4.6)
+/// - keyframes are numbered in display order from the packets' timestamps (OpenCV >= 4.7), otherwise in decode order
+///   (the same unless the video has B-frames)
+/// - optionally outputs the number of frames probed (the frame count if 'frame_limit' didn't cut the probe short)
+/// - returns false if the keyframes can't be probed
+bool cv_vid_keyframes(const std::string &vid_path,
+	const long long frame_limit,
+	std::vector<long long> &keyframes_output,
+	long long *frames_probed_output = nullptr);
+
+/// open a video, limiting the number of threads its decoder may use (<= 0 means the backend's default)
+/// - the FFmpeg backend otherwise starts about one decoding thread per core for each open video
+/// - needs OpenCV >= 4.6 (older versions open the video with the backend's default)
+bool cv_open_video(cv::VideoCapture &vid, const std::string &vid_path, const int decoder_threads);
+
 
 
 
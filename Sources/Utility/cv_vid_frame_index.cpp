@@ -0,0 +1,178 @@
+// persistent index of a video's keyframes (sidecar file next to the video)
+
+//paired header
+#include "cv_vid_frame_index.h"
+
+//local headers
+#include "cv_util.h"
+
+//third party headers
+
+//standard headers
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/// identifies the sidecar format (version 02: keyframes in display order; older sidecars are rebuilt)
+static const char s_frame_index_magic[8]{'C', 'V', 'V', 'I', 'D', 'X', '0', '2'};
+
+/// get a file's size and modification time (returns false if the file can't be read)
+static bool get_file_stamp(const std::string &path, std::int64_t &size_output, std::int64_t &mtime_output)
+{
+	struct stat file_stats{};
+
+	if (stat(path.c_str(), &file_stats) != 0)
+		return false;
+
+	size_output = static_cast<std::int64_t>(file_stats.st_size);
+	mtime_output = static_cast<std::int64_t>(file_stats.st_mtime);
+
+	return true;
+}
+
+/// read an int64 from a stream
+static bool read_int64(std::ifstream &stream, std::int64_t &value_output)
+{
+	return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value_output), sizeof(value_output)));
+}
+
+/// write an int64 to a stream
+static void write_int64(std::ofstream &stream, const std::int64_t value)
+{
+	stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/// load a sidecar if it matches the video's current size and modification time
+static bool load_frame_index(const std::string &sidecar_path,
+	const std::int64_t file_size,
+	const std::int64_t file_mtime,
+	CvVidFrameIndex &index_output)
+{
+	std::ifstream sidecar{sidecar_path, std::ios::binary};
+
+	if (!sidecar)
+		return false;
+
+	char magic[sizeof(s_frame_index_magic)]{};
+	std::int64_t stored_size{0};
+	std::int64_t stored_mtime{0};
+	std::int64_t frame_count{0};
+	std::int64_t num_keyframes{0};
+
+	if (!sidecar.read(magic, sizeof(magic)) ||
+		std::memcmp(magic, s_frame_index_magic, sizeof(magic)) != 0 ||
+		!read_int64(sidecar, stored_size) ||
+		!read_int64(sidecar, stored_mtime) ||
+		!read_int64(sidecar, frame_count) ||
+		!read_int64(sidecar, num_keyframes))
+		return false;
+
+	// stale or corrupt
+	if (stored_size != file_size || stored_mtime != file_mtime || frame_count <= 0 || num_keyframes <= 0 || num_keyframes > frame_count)
+		return false;
+
+	index_output.frame_count = frame_count;
+	index_output.keyframes.resize(static_cast<std::size_t>(num_keyframes));
+
+	for (auto &keyframe : index_output.keyframes)
+	{
+		std::int64_t stored_keyframe{0};
+
+		if (!read_int64(sidecar, stored_keyframe))
+			return false;
+
+		keyframe = stored_keyframe;
+	}
+
+	return std::is_sorted(index_output.keyframes.begin(), index_output.keyframes.end());
+}
+
+/// save a sidecar (failure is not an error: the index just gets rebuilt next time)
+static void save_frame_index(const std::string &sidecar_path,
+	const std::int64_t file_size,
+	const std::int64_t file_mtime,
+	const CvVidFrameIndex &index)
+{
+	// write to a temporary file then rename it, so a concurrent reader never sees a partial sidecar
+	const std::string temp_path{sidecar_path + "." + std::to_string(static_cast<long>(getpid())) + ".tmp"};
+
+	{
+		std::ofstream sidecar{temp_path, std::ios::binary | std::ios::trunc};
+
+		if (!sidecar)
+			return;
+
+		sidecar.write(s_frame_index_magic, sizeof(s_frame_index_magic));
+		write_int64(sidecar, file_size);
+		write_int64(sidecar, file_mtime);
+		write_int64(sidecar, index.frame_count);
+		write_int64(sidecar, static_cast<std::int64_t>(index.keyframes.size()));
+
+		for (const long long keyframe : index.keyframes)
+			write_int64(sidecar, keyframe);
+
+		if (!sidecar)
+		{
+			sidecar.close();
+			std::remove(temp_path.c_str());
+
+			return;
+		}
+	}
+
+	if (std::rename(temp_path.c_str(), sidecar_path.c_str()) != 0)
+		std::remove(temp_path.c_str());
+}
+
+bool cv_vid_frame_index(const std::string &vid_path, CvVidFrameIndex &index_output)
+{
+	index_output = CvVidFrameIndex{};
+
+	std::int64_t file_size{0};
+	std::int64_t file_mtime{0};
+
+	if (!get_file_stamp(vid_path, file_size, file_mtime))
+		return false;
+
+	const std::string sidecar_path{cv_vid_frame_index_path(vid_path)};
+
+	if (load_frame_index(sidecar_path, file_size, file_mtime, index_output))
+		return true;
+
+	// build the index from the video's packets
+	index_output = CvVidFrameIndex{};
+
+	if (!cv_vid_keyframes(vid_path, 0, index_output.keyframes, &index_output.frame_count) || index_output.frame_count <= 0)
+	{
+		index_output = CvVidFrameIndex{};
+
+		return false;
+	}
+
+	save_frame_index(sidecar_path, file_size, file_mtime, index_output);
+
+	return true;
+}
+
+std::string cv_vid_frame_index_path(const std::string &vid_path)
+{
+	return vid_path + ".cvvidx";
+}
+
+long long cv_vid_keyframe_at_or_before(const CvVidFrameIndex &index, const long long frame)
+{
+	auto next_keyframe{std::upper_bound(index.keyframes.begin(), index.keyframes.end(), frame)};
+
+	if (next_keyframe == index.keyframes.begin())
+		return 0;
+
+	return *(next_keyframe - 1);
+}
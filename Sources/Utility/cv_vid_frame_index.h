@@ -0,0 +1,49 @@
+// persistent index of a video's keyframes (sidecar file next to the video)
+
+#ifndef CV_VID_FRAME_INDEX_8841306_H
+#define CV_VID_FRAME_INDEX_8841306_H
+
+//local headers
+
+//third party headers
+
+//standard headers
+#include <string>
+#include <vector>
+
+//forward declarations
+
+
+////
+// keyframes of a video, for exact seeks: seek to the keyframe at or before a frame, then grab forward to it while
+//   counting frames (keyframes are numbered in display order, see cv_vid_keyframes())
+// - built once by reading the video's packets, then stored in '<vid_path>.cvvidx'
+// - the sidecar is rebuilt if the video's size or modification time changes
+//
+// sidecar layout (int64 values, host byte order):
+//   'CVVIDX02', file size, file modification time, frame count, number of keyframes, keyframe numbers (ascending)
+///
+/// frames the FFmpeg backend backs up before a seek target; it then decodes forward from the keyframe at or before
+///   that point, discarding the frames up to the target
+static const long long CV_VID_SEEK_BACKOFF_FRAMES = 16;
+
+struct CvVidFrameIndex
+{
+	/// number of frames in the video (counted, not estimated from the container)
+	long long frame_count{0};
+	/// frame numbers of the keyframes, in display order (ascending; see cv_vid_keyframes())
+	std::vector<long long> keyframes{};
+};
+
+/// get the frame index of a video (loads the sidecar, or builds the index and tries to save the sidecar)
+/// - returns false if the index can't be built (see cv_vid_keyframes())
+bool cv_vid_frame_index(const std::string &vid_path, CvVidFrameIndex &index_output);
+
+/// path of a video's frame index sidecar
+std::string cv_vid_frame_index_path(const std::string &vid_path);
+
+/// get the last keyframe at or before a frame (0 if the index has no such keyframe)
+long long cv_vid_keyframe_at_or_before(const CvVidFrameIndex &index, const long long frame);
+
+
+#endif	//header guard
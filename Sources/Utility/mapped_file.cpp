@@ -0,0 +1,92 @@
+// memory-mapped file (RAII)
+
+//paired header
+#include "mapped_file.h"
+
+//local headers
+#include "exception_assert.h"
+
+//third party headers
+
+//standard headers
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+MappedFile::MappedFile(const std::string &path) : m_path{path}
+{
+	m_fd = open(path.c_str(), O_RDONLY);
+	EXCEPTION_ASSERT_MSG(m_fd >= 0, "could not open file for mapping: " + path);
+
+	struct stat file_stats{};
+
+	if (fstat(m_fd, &file_stats) != 0 || file_stats.st_size <= 0)
+	{
+		close(m_fd);
+		EXCEPTION_ASSERT_MSG(false, "file to map is empty or unreadable: " + path);
+	}
+
+	m_size = static_cast<std::size_t>(file_stats.st_size);
+
+	void *mapping{mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0)};
+
+	if (mapping == MAP_FAILED)
+	{
+		close(m_fd);
+		EXCEPTION_ASSERT_MSG(false, "could not map file: " + path);
+	}
+
+	m_data = static_cast<unsigned char*>(mapping);
+
+	// the file is read front to back
+	madvise(mapping, m_size, MADV_SEQUENTIAL);
+}
+
+MappedFile::MappedFile(const std::string &path, const std::size_t size) : m_path{path}, m_size{size}, m_writable{true}
+{
+	EXCEPTION_ASSERT_MSG(size > 0, "can't map an empty file");
+
+	m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	EXCEPTION_ASSERT_MSG(m_fd >= 0, "could not create file for mapping: " + path);
+
+	if (ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+	{
+		close(m_fd);
+		EXCEPTION_ASSERT_MSG(false, "could not resize file for mapping: " + path);
+	}
+
+	void *mapping{mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)};
+
+	if (mapping == MAP_FAILED)
+	{
+		close(m_fd);
+		EXCEPTION_ASSERT_MSG(false, "could not map file: " + path);
+	}
+
+	m_data = static_cast<unsigned char*>(mapping);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+	{
+		if (m_writable)
+			msync(m_data, m_size, MS_SYNC);
+
+		munmap(m_data, m_size);
+	}
+
+	if (m_fd >= 0)
+		close(m_fd);
+}
+
+void MappedFile::Flush()
+{
+	if (m_writable && m_data)
+		EXCEPTION_ASSERT_MSG(msync(m_data, m_size, MS_SYNC) == 0, "could not flush mapped file: " + m_path);
+}
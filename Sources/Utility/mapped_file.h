@@ -0,0 +1,74 @@
+// memory-mapped file (RAII)
+
+#ifndef MAPPED_FILE_6610427_H
+#define MAPPED_FILE_6610427_H
+
+//local headers
+
+//third party headers
+
+//standard headers
+#include <cstddef>
+#include <string>
+
+//forward declarations
+
+
+////
+// maps a whole file into memory for the lifetime of the object
+// - read-only mode maps an existing file
+// - writable mode creates (or truncates) the file at the requested size; changes are flushed when the object is destroyed
+// - only available on POSIX systems
+///
+class MappedFile final
+{
+public:
+//constructors
+	/// default constructor: disabled
+	MappedFile() = delete;
+
+	/// open an existing file read-only
+	explicit MappedFile(const std::string &path);
+
+	/// create a writable file of 'size' bytes (overwrites any existing file)
+	MappedFile(const std::string &path, const std::size_t size);
+
+	/// copy constructor: disabled
+	MappedFile(const MappedFile&) = delete;
+
+//destructor
+	~MappedFile();
+
+//overloaded operators
+	/// copy assignment operator: disabled
+	MappedFile& operator=(const MappedFile&) = delete;
+
+//member functions
+	/// read access to the mapped bytes
+	const unsigned char* Data() const { return m_data; }
+
+	/// write access to the mapped bytes (nullptr if the file is read-only)
+	unsigned char* MutableData() { return m_writable ? m_data : nullptr; }
+
+	/// number of mapped bytes
+	std::size_t Size() const { return m_size; }
+
+	/// write changes back to the file now (no-op for read-only files)
+	void Flush();
+
+private:
+//member variables
+	/// path of the mapped file
+	std::string m_path{};
+	/// file descriptor
+	int m_fd{-1};
+	/// start of the mapping
+	unsigned char *m_data{nullptr};
+	/// size of the mapping (bytes)
+	std::size_t m_size{0};
+	/// whether the mapping may be written to
+	bool m_writable{false};
+};
+
+
+#endif //header guard
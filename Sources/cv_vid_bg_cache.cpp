@@ -0,0 +1,203 @@
+// on-disk cache of video background images
+
+//paired header
+#include "cv_vid_bg_cache.h"
+
+//local headers
+#include "cv_vid_bg_helpers.h"
+#include "string_utils.h"
+
+//third party headers
+#include <opencv2/opencv.hpp>   //for video manipulation (mainly)
+
+//standard headers
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/// number of decoded frames hashed for a video fingerprint (spread over the video)
+static constexpr int s_fingerprint_frames{4};
+
+/// FNV-1a hash of a byte range, continuing from 'hash'
+static std::uint64_t HashBytes(const unsigned char *bytes, const std::size_t num_bytes, std::uint64_t hash = 14695981039346656037ULL)
+{
+    for (std::size_t byte_index{0}; byte_index < num_bytes; byte_index++)
+    {
+        hash ^= bytes[byte_index];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/// FNV-1a hash of a string, continuing from 'hash'
+static std::uint64_t HashString(const std::string &str, std::uint64_t hash)
+{
+    // include the length so consecutive strings can't run together
+    const std::uint64_t length{str.size()};
+    hash = HashBytes(reinterpret_cast<const unsigned char*>(&length), sizeof(length), hash);
+
+    return HashBytes(reinterpret_cast<const unsigned char*>(str.data()), str.size(), hash);
+}
+
+/// FNV-1a hash of a frame's pixels, continuing from 'hash'
+static std::uint64_t HashFrame(const cv::Mat &frame, std::uint64_t hash)
+{
+    const std::size_t row_bytes{static_cast<std::size_t>(frame.cols)*frame.elemSize()};
+
+    for (int row{0}; row < frame.rows; row++)
+        hash = HashBytes(frame.ptr<unsigned char>(row), row_bytes, hash);
+
+    return hash;
+}
+
+/// cache file for one statistic of a crop region
+static std::string GetCachedVidBackgroundPath(const std::string &cache_dir,
+    const VidBgCacheKey &key,
+    const cv::Rect &crop_region,
+    const std::string &statistic)
+{
+    return cache_dir + "/" + key.vid_fingerprint + "_" + key.settings_hash +
+        format_string("_%dx%d+%d+%d_", crop_region.width, crop_region.height, crop_region.x, crop_region.y) + statistic + ".png";
+}
+
+VidBgCacheKey GetVidBgCacheKey(cv::VideoCapture &vid, const VidBgPack &vidbg_pack)
+{
+    VidBgCacheKey key{};
+    key.frame_size = cv::Size{static_cast<int>(vid.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int>(vid.get(cv::CAP_PROP_FRAME_HEIGHT))};
+
+    /// video fingerprint
+
+    // file size and modification time catch almost every change for free
+    std::uint64_t fingerprint{HashString(vidbg_pack.vid_path, 14695981039346656037ULL)};
+    struct stat file_stats{};
+
+    if (stat(vidbg_pack.vid_path.c_str(), &file_stats) == 0)
+    {
+        const std::int64_t file_size{static_cast<std::int64_t>(file_stats.st_size)};
+        const std::int64_t file_mtime{static_cast<std::int64_t>(file_stats.st_mtime)};
+
+        fingerprint = HashBytes(reinterpret_cast<const unsigned char*>(&file_size), sizeof(file_size), fingerprint);
+        fingerprint = HashBytes(reinterpret_cast<const unsigned char*>(&file_mtime), sizeof(file_mtime), fingerprint);
+    }
+
+    // a few decoded frames catch files replaced with the same size and time stamp
+    const long long total_frames{static_cast<long long>(vid.get(cv::CAP_PROP_FRAME_COUNT))};
+    cv::Mat frame{};
+
+    for (int sample_index{0}; sample_index < s_fingerprint_frames && total_frames > 0; sample_index++)
+    {
+        vid.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(sample_index*total_frames/s_fingerprint_frames));
+
+        if (vid.read(frame) && !frame.empty())
+            fingerprint = HashFrame(frame, fingerprint);
+    }
+
+    // leave the video where it was found
+    vid.set(cv::CAP_PROP_POS_FRAMES, 0);
+
+    key.vid_fingerprint = format_string("%016llx", static_cast<unsigned long long>(fingerprint));
+
+    /// settings hash (everything that changes the images, except the crop and statistics)
+    // - 'bgr2gray': color frames are converted to grayscale as BGR (images cached before that used RGB weights)
+    std::string settings{format_string("%s|%lld|%d|%d|%d|%d|%.17g|%lld|%lld|%lld|%.17g|%d|%d|bgr2gray",
+        vidbg_pack.bg_algo.c_str(),
+        vidbg_pack.frame_limit,
+        static_cast<int>(vidbg_pack.grayscale),
+        static_cast<int>(vidbg_pack.vid_is_grayscale),
+        static_cast<int>(vidbg_pack.compact_histograms),
+        vidbg_pack.convergence_check_interval,
+        vidbg_pack.convergence_tolerance,
+        vidbg_pack.sample_frames,
+        vidbg_pack.sample_seed,
+        vidbg_pack.start_frame,
+        vidbg_pack.dedup_threshold,
+        static_cast<int>(vidbg_pack.decode_luma),
+        static_cast<int>(vidbg_pack.use_frame_index))};
+
+    key.settings_hash = format_string("%016llx", static_cast<unsigned long long>(HashString(settings, 14695981039346656037ULL)));
+    key.crop_independent = vidbg_pack.dedup_threshold <= 0.0 && vidbg_pack.convergence_check_interval <= 0;
+
+    return key;
+}
+
+bool LoadCachedVidBackgrounds(const std::string &cache_dir,
+    const VidBgCacheKey &key,
+    const cv::Rect &crop_region,
+    const std::vector<std::string> &statistics,
+    std::vector<cv::Mat> &images_out)
+{
+    images_out.clear();
+
+    const std::vector<std::string> statistic_names{statistics.empty() ? std::vector<std::string>{"median"} : statistics};
+    const cv::Rect full_frame{0, 0, key.frame_size.width, key.frame_size.height};
+
+    for (const auto &statistic : statistic_names)
+    {
+        // prefer an image of the crop region itself
+        cv::Mat image{cv::imread(GetCachedVidBackgroundPath(cache_dir, key, crop_region, statistic), cv::IMREAD_UNCHANGED)};
+
+        // otherwise slice the full frame's image
+        if (image.empty() && crop_region != full_frame && key.crop_independent)
+        {
+            cv::Mat full_image{cv::imread(GetCachedVidBackgroundPath(cache_dir, key, full_frame, statistic), cv::IMREAD_UNCHANGED)};
+
+            if (full_image.size() == key.frame_size)
+                image = full_image(crop_region).clone();
+        }
+
+        if (image.empty() || image.size() != crop_region.size())
+        {
+            images_out.clear();
+
+            return false;
+        }
+
+        images_out.emplace_back(std::move(image));
+    }
+
+    return true;
+}
+
+void SaveCachedVidBackgrounds(const std::string &cache_dir,
+    const VidBgCacheKey &key,
+    const cv::Rect &crop_region,
+    const std::vector<std::string> &statistics,
+    const std::vector<cv::Mat> &images)
+{
+    const std::vector<std::string> statistic_names{statistics.empty() ? std::vector<std::string>{"median"} : statistics};
+
+    if (images.size() != statistic_names.size())
+        return;
+
+    // make the cache directory (one level)
+    if (mkdir(cache_dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        std::cerr << "warning, could not create background cache directory: " << cache_dir << '\n';
+
+        return;
+    }
+
+    for (std::size_t image_index{0}; image_index < images.size(); image_index++)
+    {
+        if (images[image_index].empty())
+            continue;
+
+        // write to a temporary file then rename it, so a concurrent reader never sees a partial image
+        const std::string path{GetCachedVidBackgroundPath(cache_dir, key, crop_region, statistic_names[image_index])};
+        const std::string temp_path{path + format_string(".%ld.tmp.png", static_cast<long>(getpid()))};
+
+        if (!cv::imwrite(temp_path, images[image_index]) || std::rename(temp_path.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temp_path.c_str());
+            std::cerr << "warning, could not save background to cache: " << path << '\n';
+        }
+    }
+}
@@ -0,0 +1,55 @@
+// on-disk cache of video background images
+
+#ifndef CV_VID_BG_CACHE_2281734_H
+#define CV_VID_BG_CACHE_2281734_H
+
+//local headers
+
+//third party headers
+#include <opencv2/opencv.hpp>   //for video manipulation (mainly)
+
+//standard headers
+#include <string>
+#include <vector>
+
+//forward declarations
+struct VidBgPack;
+
+
+/// identifies the background images of one video computed with one set of settings (any crop, any statistic)
+struct VidBgCacheKey
+{
+    // fingerprint of the video file (size, modification time, and hashes of a few decoded frames)
+    std::string vid_fingerprint{};
+    // hash of the settings that affect the background images (except the crop and the statistics)
+    std::string settings_hash{};
+    // size of the uncropped video frames
+    cv::Size frame_size{};
+    // if each pixel's result is independent of the crop region, so images of the whole frame can be sliced to any crop
+    // - not with frame dedup or convergence checks, which look at the whole crop region to pick frames
+    bool crop_independent{true};
+};
+
+/// get the cache key of a video's background settings (decodes a few frames of the video)
+VidBgCacheKey GetVidBgCacheKey(cv::VideoCapture &vid, const VidBgPack &vidbg_pack);
+
+/// try to get cached background images for a crop region (one per statistic; empty means 'median only')
+/// - images cached for the whole frame are sliced to the crop region if the region itself was never cached (only if
+///   the key's results are crop-independent)
+/// - returns false unless every statistic was found
+bool LoadCachedVidBackgrounds(const std::string &cache_dir,
+    const VidBgCacheKey &key,
+    const cv::Rect &crop_region,
+    const std::vector<std::string> &statistics,
+    std::vector<cv::Mat> &images_out);
+
+/// save background images of a crop region to the cache (one per statistic; empty means 'median only')
+/// - creates the cache directory if needed; each image is written to a temporary file first so readers never see partial files
+void SaveCachedVidBackgrounds(const std::string &cache_dir,
+    const VidBgCacheKey &key,
+    const cv::Rect &crop_region,
+    const std::vector<std::string> &statistics,
+    const std::vector<cv::Mat> &images);
+
+
+#endif //header guard
@@ -6,21 +6,38 @@
 //local headers
 #include "async_token_batch_generator.h"
 #include "async_token_process.h"
+#include "cv_frame_cache.h"
+#include "cv_frame_source.h"
+#include "cv_image_sequence_generator_algo.h"
+#include "cv_vid_bg_cache.h"
 #include "cv_vid_frames_generator_algo.h"
+#include "cv_vid_frame_index.h"
 #include "cv_vid_fragment_consumer.h"
+#include "cv_util.h"
+#include "element_histograms.h"
 #include "exception_assert.h"
+#include "histogram_checkpoint.h"
+#include "histogram_convergence_monitor.h"
 #include "histogram_median_algo.h"
+#include "histogram_merge_consumer.h"
+#include "histogram_shard_algo.h"
 #include "main.h"
+#include "raw_frames_generator_algo.h"
+#include "token_batch_generator.h"
 
 //third party headers
 #include <opencv2/opencv.hpp>   //for video manipulation (mainly)
 
 //standard headers
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <list>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 
@@ -36,6 +53,74 @@ BGAlgo GetBGAlgo(const std::string &algo)
     }
 }
 
+/// parse the number at the end of a statistic string (e.g. 'p10' -> 10.0)
+static double GetStatisticParameter(const std::string &statistic, const std::size_t prefix_length)
+{
+    EXCEPTION_ASSERT_MSG(statistic.size() > prefix_length, "histogram statistic is missing its number");
+
+    std::size_t chars_parsed{0};
+    double parameter{0.0};
+
+    try
+    {
+        parameter = std::stod(statistic.substr(prefix_length), &chars_parsed);
+    }
+    catch (...)
+    {
+        EXCEPTION_ASSERT_MSG(false, "histogram statistic has an invalid number");
+    }
+
+    EXCEPTION_ASSERT_MSG(chars_parsed + prefix_length == statistic.size(), "histogram statistic has an invalid number");
+
+    return parameter;
+}
+
+/// get histogram statistic from string
+HistogramStatistic GetHistogramStatistic(const std::string &statistic)
+{
+    if (statistic == "median")
+        return HistogramStatistic{HistogramStatType::PERCENTILE, 50.0};
+    else if (statistic == "mode")
+        return HistogramStatistic{HistogramStatType::MODE, 0.0};
+    else if (statistic == "mean")
+        return HistogramStatistic{HistogramStatType::TRIMMED_MEAN, 0.0};
+    else if (statistic == "iqr")
+        return HistogramStatistic{HistogramStatType::INTERQUARTILE_RANGE, 0.0};
+    else if (statistic == "mad")
+        return HistogramStatistic{HistogramStatType::MEDIAN_ABSOLUTE_DEVIATION, 0.0};
+    else if (statistic.compare(0, 5, "tmean") == 0)
+    {
+        double trim_percent{GetStatisticParameter(statistic, 5)};
+        EXCEPTION_ASSERT_MSG(trim_percent >= 0.0 && trim_percent < 50.0, "trimmed mean must trim [0, 50) percent from each tail");
+
+        return HistogramStatistic{HistogramStatType::TRIMMED_MEAN, trim_percent};
+    }
+    else if (statistic.compare(0, 1, "p") == 0)
+    {
+        double percentile{GetStatisticParameter(statistic, 1)};
+        EXCEPTION_ASSERT_MSG(percentile >= 0.0 && percentile <= 100.0, "percentile must be in [0, 100]");
+
+        return HistogramStatistic{HistogramStatType::PERCENTILE, percentile};
+    }
+
+    std::cerr << "Unknown histogram statistic detected: " << statistic << '\n';
+    EXCEPTION_ASSERT_MSG(false, "unknown histogram statistic");
+
+    return HistogramStatistic{};
+}
+
+/// get histogram statistics from strings
+std::vector<HistogramStatistic> GetHistogramStatistics(const std::vector<std::string> &statistics)
+{
+    std::vector<HistogramStatistic> histogram_statistics{};
+    histogram_statistics.reserve(statistics.size());
+
+    for (const auto &statistic : statistics)
+        histogram_statistics.emplace_back(GetHistogramStatistic(statistic));
+
+    return histogram_statistics;
+}
+
 cv::Rect GetCroppedFrameDims(int x, int y, int width, int height, int hor_pixels, int vert_pixels)
 {
     // note: the returned frame is not allowed to be empty
@@ -59,82 +144,473 @@ cv::Rect GetCroppedFrameDims(int x, int y, int width, int height, int hor_pixels
     return cv::Rect{x, y, width, height};
 }
 
-template <typename MedianAlgo>
-cv::Mat VidBackgroundWithAlgo(cv::VideoCapture &vid,
-    const VidBgPack &vidbg_pack,
-    std::vector<TokenProcessorPack<MedianAlgo>> &processor_packs,
-    const int generator_threads,
-    const bool synchronous_allowed)
+cv::Rect GetSourceFrameDims(const CvFrameSource &frame_source, int x, int y, int width, int height)
 {
-    // number of fragments to create during background analysis
-    int batch_size{static_cast<int>(processor_packs.size())};
-    assert(batch_size);
+    // the frames of pre-cropped sources are the crop region already (their cache key matched the requested crop)
+    if (!frame_source.source_crop.empty())
+        return cv::Rect{0, 0, frame_source.frame_width, frame_source.frame_height};
 
-    cv::Rect frame_dimensions{GetCroppedFrameDims(vidbg_pack.crop_x, vidbg_pack.crop_y, vidbg_pack.crop_width, vidbg_pack.crop_height,
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_WIDTH)),
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_HEIGHT)))};
+    return GetCroppedFrameDims(x, y, width, height, frame_source.frame_width, frame_source.frame_height);
+}
 
-    /// create frame generator
+BgThreadPlan GetBgThreadPlan(const VidBgPack &vidbg_pack)
+{
+    BgThreadPlan plan{};
+
+    // set the batch size
+    plan.batch_size = GetAdditionalThreads(1, 0, vidbg_pack.max_threads);
+
+    // if no batch size specified then use synchronous mode (should fall through downstream)
+    // should only happen if user specified max_threads=1 or the hardware concurrency is unavailable
+    plan.generator_threads = 1;
+
+    if (plan.batch_size <= 0)
+    {
+        plan.batch_size = 1;
+        plan.synchronous = true;
+    }
+    else
+    {
+        // divide available threads between the token generator and processor: HEURISTIC
+        // - the generator's share also covers its video decoders' threads (see GetBgGeneratorPacks())
+        int total_threads = plan.generator_threads + plan.batch_size;
+        plan.generator_threads = total_threads / 2;
+        plan.batch_size = total_threads - plan.generator_threads;     //processor gets extra thread in case of odd total number
+    }
+
+    assert(plan.generator_threads);
+    assert(plan.batch_size);
+
+    return plan;
+}
+
+long long GetBgHistogramBytesPerRow(const VidBgPack &vidbg_pack,
+    const BgThreadPlan &thread_plan,
+    const int crop_width,
+    const int histogram_element_bytes)
+{
+    // frames are converted to RGB unless they are grayscale
+    long long channels{(vidbg_pack.grayscale || vidbg_pack.vid_is_grayscale) ? 1 : 3};
+
+    // 256 histogram bins per element
+    long long bytes_per_row{256*static_cast<long long>(crop_width)*channels*histogram_element_bytes};
+
+    // every temporal shard holds histograms for the whole region (checkpoints are saved from temporal shards)
+    if (vidbg_pack.temporal_shards || !vidbg_pack.checkpoint_path.empty())
+        bytes_per_row *= thread_plan.batch_size;
+
+    return bytes_per_row;
+}
+
+std::vector<cv::Rect> GetBgMemoryStripes(const VidBgPack &vidbg_pack,
+    const BgThreadPlan &thread_plan,
+    const cv::Rect &frame_dimensions,
+    const int histogram_element_bytes)
+{
+    std::vector<cv::Rect> stripes{};
+
+    long long bytes_per_row{GetBgHistogramBytesPerRow(vidbg_pack, thread_plan, frame_dimensions.width, histogram_element_bytes)};
+    long long total_bytes{bytes_per_row*frame_dimensions.height};
+    long long memory_limit_bytes{vidbg_pack.memory_limit_mb*1024*1024};
+
+    // no limit, or everything fits
+    if (vidbg_pack.memory_limit_mb <= 0 || total_bytes <= memory_limit_bytes)
+    {
+        stripes.emplace_back(frame_dimensions);
+
+        return stripes;
+    }
+
+    // rows that fit in the budget (at least one row per stripe is unavoidable)
+    long long rows_per_stripe{memory_limit_bytes / bytes_per_row};
+
+    if (rows_per_stripe < 1)
+    {
+        std::cerr << "warning, background histograms for one row of pixels (" << bytes_per_row/(1024*1024) <<
+            " MB) exceed the memory limit (" << vidbg_pack.memory_limit_mb << " MB)!\n";
+
+        rows_per_stripe = 1;
+    }
+
+    // spread rows evenly between stripes so the last stripe isn't a sliver
+    int num_stripes{static_cast<int>((frame_dimensions.height + rows_per_stripe - 1) / rows_per_stripe)};
+    int stripe_rows{frame_dimensions.height / num_stripes};
+    int remainder_rows{frame_dimensions.height % num_stripes};
+    int stripe_y{frame_dimensions.y};
+
+    std::cout << "Background histograms need " << total_bytes/(1024*1024) << " MB (limit " << vidbg_pack.memory_limit_mb <<
+        " MB), processing " << num_stripes << " stripes (one pass over the video each)\n";
 
+    stripes.reserve(num_stripes);
+
+    for (int stripe_index{0}; stripe_index < num_stripes; stripe_index++)
+    {
+        int rows{stripe_rows + (stripe_index < remainder_rows ? 1 : 0)};
+
+        stripes.emplace_back(frame_dimensions.x, stripe_y, frame_dimensions.width, rows);
+        stripe_y += rows;
+    }
+
+    return stripes;
+}
+
+std::vector<long long> GetBgSampleFrames(const long long total_frames, const long long sample_frames, const long long sample_seed)
+{
+    std::vector<long long> frame_indices{};
+
+    if (total_frames <= 0 || sample_frames <= 0)
+        return frame_indices;
+
+    // can't sample more frames than there are
+    if (sample_frames >= total_frames)
+    {
+        frame_indices.resize(total_frames);
+        std::iota(frame_indices.begin(), frame_indices.end(), 0);
+
+        return frame_indices;
+    }
+
+    frame_indices.reserve(sample_frames);
+
+    if (sample_seed < 0)
+    {
+        // uniform: the middle frame of each of 'sample_frames' equal spans
+        for (long long sample_index{0}; sample_index < sample_frames; sample_index++)
+            frame_indices.emplace_back((2*sample_index + 1)*total_frames/(2*sample_frames));
+    }
+    else
+    {
+        // random: Floyd's algorithm picks distinct frames without materializing every frame index
+        std::mt19937_64 generator{static_cast<std::uint64_t>(sample_seed)};
+        std::unordered_set<long long> picked{};
+
+        for (long long candidate_max{total_frames - sample_frames}; candidate_max < total_frames; candidate_max++)
+        {
+            long long candidate{std::uniform_int_distribution<long long>{0, candidate_max}(generator)};
+
+            if (!picked.insert(candidate).second)
+            {
+                candidate = candidate_max;
+                picked.insert(candidate);
+            }
+
+            frame_indices.emplace_back(candidate);
+        }
+
+        std::sort(frame_indices.begin(), frame_indices.end());
+    }
+
+    return frame_indices;
+}
+
+/// move the boundaries between workers' shares of consecutive frames to 'seek_offset' frames after the nearest keyframes
+/// - with exact seeks (frame index), an offset of 0 starts each worker on a keyframe, so it grabs no frames up to its
+///   start (the backend's own seek still decodes from the keyframe before its back-off point)
+/// - with plain CAP_PROP_POS_FRAMES seeks, an offset of CV_VID_SEEK_BACKOFF_FRAMES makes the backend's seek decode
+///   forward from that keyframe, so it discards only that many frames of the previous share instead of up to a whole
+///   keyframe interval
+/// - shares are offsets from 'start_frame'; the first and last bounds don't move
+/// - workers whose share would be empty are dropped; the bounds are left alone if there are no keyframes
+static void AlignBgSharesToKeyframes(const std::vector<long long> &keyframes,
+    const long long start_frame,
+    const long long seek_offset,
+    std::vector<long long> &share_bounds)
+{
+    assert(share_bounds.size() >= 2);
+
+    if (keyframes.empty())
+        return;
+
+    std::vector<long long> aligned_bounds{share_bounds.front()};
+    aligned_bounds.reserve(share_bounds.size());
+
+    for (std::size_t bound_index{1}; bound_index + 1 < share_bounds.size(); bound_index++)
+    {
+        const long long target_frame{start_frame + share_bounds[bound_index] - seek_offset};
+
+        // nearest keyframe to the even split (less the offset)
+        auto next_keyframe{std::lower_bound(keyframes.begin(), keyframes.end(), target_frame)};
+        long long keyframe{next_keyframe == keyframes.end() ? keyframes.back() : *next_keyframe};
+
+        if (next_keyframe != keyframes.begin() &&
+            (next_keyframe == keyframes.end() || target_frame - *(next_keyframe - 1) < *next_keyframe - target_frame))
+            keyframe = *(next_keyframe - 1);
+
+        const long long bound{keyframe + seek_offset - start_frame};
+
+        // skip bounds that would leave a worker with nothing to do (e.g. long GOPs)
+        if (bound > aligned_bounds.back() && bound < share_bounds.back())
+            aligned_bounds.emplace_back(bound);
+    }
+
+    aligned_bounds.emplace_back(share_bounds.back());
+    share_bounds = std::move(aligned_bounds);
+}
+
+std::shared_ptr<TokenBatchGenerator<cv::Mat>> StartFramesGenerator(const std::vector<const CvFrameSource*> &pack_sources,
+    std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs,
+    const int batch_size,
+    const bool collect_timings,
+    const int token_storage_limit)
+{
+    EXCEPTION_ASSERT(generator_packs.size() && pack_sources.size() == generator_packs.size());
+
+    const CvFrameSourceType source_type{pack_sources.front()->type};
+
+    for (const CvFrameSource *pack_source : pack_sources)
+        EXCEPTION_ASSERT_MSG(pack_source && pack_source->type == source_type, "frames of one generator must come from the same kind of source");
+
+    switch (source_type)
+    {
+        case CvFrameSourceType::IMAGE_SEQUENCE :
+        {
+            std::vector<TokenGeneratorPack<CvImageSequenceGeneratorAlgo>> sequence_packs{};
+            sequence_packs.reserve(generator_packs.size());
+
+            for (std::size_t pack_index{0}; pack_index < generator_packs.size(); pack_index++)
+            {
+                sequence_packs.emplace_back(TokenGeneratorPack<CvImageSequenceGeneratorAlgo>{
+                    std::move(generator_packs[pack_index]),
+                    pack_sources[pack_index]->image_paths
+                });
+            }
+
+            auto frame_gen{std::make_shared<AsyncTokenBatchGenerator<CvImageSequenceGeneratorAlgo>>(batch_size, collect_timings, token_storage_limit)};
+            frame_gen->StartGenerator(std::move(sequence_packs));
+
+            return frame_gen;
+        }
+
+        case CvFrameSourceType::RAW_FRAMES :
+        {
+            std::vector<TokenGeneratorPack<RawFramesGeneratorAlgo>> raw_packs{};
+            raw_packs.reserve(generator_packs.size());
+
+            for (std::size_t pack_index{0}; pack_index < generator_packs.size(); pack_index++)
+            {
+                raw_packs.emplace_back(TokenGeneratorPack<RawFramesGeneratorAlgo>{
+                    std::move(generator_packs[pack_index]),
+                    pack_sources[pack_index]->raw_frames
+                });
+            }
+
+            auto frame_gen{std::make_shared<AsyncTokenBatchGenerator<RawFramesGeneratorAlgo>>(batch_size, collect_timings, token_storage_limit)};
+            frame_gen->StartGenerator(std::move(raw_packs));
+
+            return frame_gen;
+        }
+
+        default :
+        {
+            auto frame_gen{std::make_shared<AsyncTokenBatchGenerator<CvVidFramesGeneratorAlgo>>(batch_size, collect_timings, token_storage_limit)};
+            frame_gen->StartGenerator(std::move(generator_packs));
+
+            return frame_gen;
+        }
+    };
+}
+
+std::shared_ptr<TokenBatchGenerator<cv::Mat>> StartFramesGenerator(const CvFrameSource &frame_source,
+    std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs,
+    const int batch_size,
+    const bool collect_timings,
+    const int token_storage_limit)
+{
+    const std::vector<const CvFrameSource*> pack_sources(generator_packs.size(), &frame_source);
+
+    return StartFramesGenerator(pack_sources, std::move(generator_packs), batch_size, collect_timings, token_storage_limit);
+}
+
+std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> GetBgGeneratorPacks(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions,
+    const int frames_in_batch,
+    const int chunks_per_frame,
+    const int generator_threads,
+    const std::shared_ptr<CvVidFramesGeneratorControl> &generator_control,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache/* = nullptr*/)
+{
     // frame generator packs
     std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs{};
     assert(generator_threads >= 1);
     generator_packs.reserve(generator_threads);
 
-    // divide the video into ranges of frames for the async generator
-    long long begin_frame{0};
-    long long sum_frame{0};
-    long long remainder_frames{0};
-    if (vid.isOpened())
+    long long num_frames{frame_source.frame_count};
+
+    // the frame index makes seeks exact (and its frame count is counted, unlike the container's estimate)
+    // - other sources read frames directly, so they don't need one
+    const bool source_is_video{frame_source.type == CvFrameSourceType::VIDEO};
+    std::shared_ptr<const CvVidFrameIndex> frame_index{};
+
+    if (vidbg_pack.use_frame_index && source_is_video)
     {
-        int num_frames{static_cast<int>(vid.get(cv::CAP_PROP_FRAME_COUNT))};
+        auto new_frame_index{std::make_shared<CvVidFrameIndex>()};
 
-        // cap range of frames to analyze at the frame limit
-        if (vidbg_pack.frame_limit > 0)
+        if (cv_vid_frame_index(frame_source.path, *new_frame_index))
         {
-            if (num_frames > vidbg_pack.frame_limit)
-                num_frames = vidbg_pack.frame_limit;
+            num_frames = new_frame_index->frame_count;
+            frame_index = std::move(new_frame_index);
         }
+        else
+            std::cerr << "warning, could not index the frames of video: " << frame_source.path << '\n';
+    }
+
+    // frames before the start frame are ignored
+    EXCEPTION_ASSERT_MSG(vidbg_pack.start_frame >= 0 && vidbg_pack.start_frame < num_frames, "background start frame is outside the video");
+    num_frames -= vidbg_pack.start_frame;
+
+    // sampling mode: frames spread across the whole video (after the start frame)
+    std::vector<long long> sample_frames{GetBgSampleFrames(num_frames, vidbg_pack.sample_frames, vidbg_pack.sample_seed)};
+
+    for (auto &sample_frame : sample_frames)
+        sample_frame += vidbg_pack.start_frame;
+
+    // cap range of frames to analyze at the frame limit
+    if (sample_frames.empty() && vidbg_pack.frame_limit > 0)
+    {
+        if (num_frames > vidbg_pack.frame_limit)
+            num_frames = vidbg_pack.frame_limit;
+    }
+
+    // each worker gets a contiguous share of the frames (or of the sampled frames, so its seeks only go forward)
+    const long long frames_to_divide{sample_frames.empty() ? num_frames : static_cast<long long>(sample_frames.size())};
+    long long num_workers{std::max(1LL, std::min(static_cast<long long>(generator_threads), frames_to_divide))};
+
+    // the workers' decoder threads come out of the generator threads, so decoding doesn't oversubscribe the cores
+    int decoder_threads{0};
+
+    if (source_is_video && vidbg_pack.decoder_threads > 0)
+    {
+        // a fixed count is capped at the generator threads (one worker gets them all)
+        decoder_threads = std::min(vidbg_pack.decoder_threads, generator_threads);
+        num_workers = std::max(1LL, std::min(num_workers, static_cast<long long>(generator_threads / decoder_threads)));
+    }
+
+    const long long sum_frame{frames_to_divide / num_workers};
+    const long long remainder_frames{frames_to_divide % num_workers};
+
+    std::vector<long long> share_bounds{0};
+    share_bounds.reserve(num_workers + 1);
+
+    for (long long i{0}; i < num_workers; i++)
+        share_bounds.emplace_back(share_bounds.back() + sum_frame + (i + 1 == num_workers ? remainder_frames : 0));
+
+    // consecutive frames: start each worker on (exact seeks) or just after (plain seeks) a keyframe, so its first seek
+    //   decodes few of the previous worker's frames (see AlignBgSharesToKeyframes())
+    if (sample_frames.empty() && num_workers > 1 && source_is_video)
+    {
+        std::vector<long long> probed_keyframes{};
+
+        if (!frame_index)
+            cv_vid_keyframes(frame_source.path, vidbg_pack.start_frame + share_bounds.back(), probed_keyframes);
 
-        sum_frame = num_frames / generator_threads;
-        remainder_frames = num_frames % generator_threads;
+        AlignBgSharesToKeyframes(frame_index ? frame_index->keyframes : probed_keyframes,
+            vidbg_pack.start_frame,
+            frame_index ? 0 : CV_VID_SEEK_BACKOFF_FRAMES,
+            share_bounds);
     }
 
-    for (std::size_t i{0}; i < generator_threads; i++)
+    // grid each frame is split into
+    int chunk_cols{1};
+    int chunk_rows{1};
+    EXCEPTION_ASSERT_MSG(cv_chunk_grid(chunks_per_frame,
+            frame_dimensions.width,
+            frame_dimensions.height,
+            vidbg_pack.chunk_rows,
+            chunk_cols,
+            chunk_rows),
+        "frames are too small to split into one chunk per thread");
+
+    // chunk layout (shared by all generators, and by whatever stitches their chunks back together)
+    auto chunk_plan{std::make_shared<ChunkPlan>()};
+    EXCEPTION_ASSERT(cv_chunk_plan(*chunk_plan, frame_dimensions.width, frame_dimensions.height, chunk_cols, chunk_rows));
+
+    for (std::size_t i{0}; i + 1 < share_bounds.size(); i++)
     {
+        const long long begin_share{share_bounds[i]};
+        const long long end_share{share_bounds[i + 1]};
+
+        long long begin_frame{vidbg_pack.start_frame + begin_share};
+        long long end_frame{vidbg_pack.start_frame + end_share};
+        std::vector<long long> worker_frames{};
+
+        if (sample_frames.size())
+        {
+            worker_frames.assign(sample_frames.begin() + begin_share, sample_frames.begin() + end_share);
+            begin_frame = worker_frames.front();
+            end_frame = worker_frames.back() + 1;
+        }
+
         generator_packs.emplace_back(TokenGeneratorPack<CvVidFramesGeneratorAlgo>{
-            batch_size,
-            1,
-            batch_size,
-            vidbg_pack.vid_path,
+            frames_in_batch*chunks_per_frame,
+            frames_in_batch,
+            chunks_per_frame,
+            frame_source.path,
             begin_frame,
-            begin_frame + sum_frame + (i + 1 == generator_threads ? remainder_frames : 0),
+            end_frame,
             frame_dimensions,
             vidbg_pack.grayscale,
             vidbg_pack.vid_is_grayscale,
             0,  //no buffer
-            0   //no buffer
+            0,  //no buffer
+            generator_control,
+            std::move(worker_frames),
+            0,  //no rolling background
+            0,
+            cv::Mat{},
+            vidbg_pack.dedup_threshold,
+            frame_index,
+            vidbg_pack.decode_luma,
+            true,   //histogram algos only read their chunks
+            chunk_rows,
+            chunk_cols,
+            chunk_plan,
+            frame_cache,
+            decoder_threads
         });
-
-        begin_frame += sum_frame;
     }
 
+    return generator_packs;
+}
+
+template <typename MedianAlgo>
+cv::Mat VidBackgroundWithAlgo(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions,
+    std::vector<TokenProcessorPack<MedianAlgo>> &processor_packs,
+    const int generator_threads,
+    const bool synchronous_allowed,
+    const std::shared_ptr<CvVidFramesGeneratorControl> &generator_control,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache/* = nullptr*/)
+{
+    // number of fragments to create during background analysis
+    int batch_size{static_cast<int>(processor_packs.size())};
+    assert(batch_size);
+
+    /// create frame generator
+
+    // frame generator packs (each frame is split into one chunk per processing unit)
+    std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs{
+            GetBgGeneratorPacks(frame_source, vidbg_pack, frame_dimensions, 1, batch_size, generator_threads, generator_control, frame_cache)
+        };
+
+    // chunk layout shared by the generators and the fragment consumer
+    assert(generator_packs.size());
+    const std::shared_ptr<const ChunkPlan> chunk_plan{generator_packs.front().chunk_plan};
+
     // frame generator
-    auto frame_gen{std::make_shared<AsyncTokenBatchGenerator<CvVidFramesGeneratorAlgo>>(
+    auto frame_gen{StartFramesGenerator(frame_source,
+        std::move(generator_packs),
         batch_size,
         vidbg_pack.print_timing_report,
         vidbg_pack.token_storage_limit
     )};
 
-    frame_gen->StartGenerator(std::move(generator_packs));
-
-    // create fragment consumer
+    // create fragment consumer (stitches with the generators' chunk plan)
     auto bg_frag_consumer{std::make_shared<CvVidFragmentConsumer>(batch_size,
         vidbg_pack.print_timing_report,
-        0,  //no buffer
-        0,  //no buffer
-        frame_dimensions.width,
-        frame_dimensions.height
+        1,  //one frame per batch
+        chunk_plan
     )};
 
     // create process
@@ -160,91 +636,359 @@ cv::Mat VidBackgroundWithAlgo(cv::VideoCapture &vid,
         return cv::Mat{};
 }
 
-template <typename MedianAlgo>
-cv::Mat VidBackgroundWithAlgoEmptyPacks(cv::VideoCapture &vid, const VidBgPack &vidbg_pack)
+/// run the temporal shard pipeline on the frames from some frame generators, and get the shards' merged histograms
+template <typename T>
+static std::unique_ptr<ElementHistograms<T>> VidHistogramsWithShards(const VidBgPack &vidbg_pack,
+    const std::vector<const CvFrameSource*> &pack_sources,
+    std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs,
+    std::vector<TokenProcessorPack<HistogramShardAlgo<T>>> &processor_packs,
+    const bool synchronous_allowed)
 {
-    // set the batch size
-    int batch_size{GetAdditionalThreads(1, 0, vidbg_pack.max_threads)};
-    bool synchronous{false};
+    // number of shards
+    int batch_size{static_cast<int>(processor_packs.size())};
+    assert(batch_size);
 
-    // if no batch size specified then use synchronous mode (should fall through downstream)
-    // should only happen if user specified max_threads=1 or the hardware concurrency is unavailable
-    int generator_threads{1};
+    // frame generator
+    auto frame_gen{StartFramesGenerator(pack_sources,
+        std::move(generator_packs),
+        batch_size,
+        vidbg_pack.print_timing_report,
+        vidbg_pack.token_storage_limit
+    )};
+
+    // create histogram consumer (reduction step: sums the shards' histograms)
+    auto histogram_merger{std::make_shared<HistogramMergeConsumer<T>>(batch_size,
+        vidbg_pack.print_timing_report
+    )};
+
+    // create process
+    AsyncTokenProcess<HistogramShardAlgo<T>, typename HistogramMergeConsumer<T>::final_result_type> vid_bg_prod{batch_size,
+        synchronous_allowed,
+        vidbg_pack.print_timing_report,
+        vidbg_pack.token_storage_limit,
+        vidbg_pack.token_storage_limit,
+        frame_gen,
+        histogram_merger
+    };
+
+    // run process to get merged histograms
+    auto histograms{vid_bg_prod.Run(std::move(processor_packs))};
+
+    // print out timing info
+    if (vidbg_pack.print_timing_report)
+        std::cout << vid_bg_prod.GetTimingInfoAndResetTimer();
+
+    return histograms;
+}
+
+template <typename T>
+std::vector<cv::Mat> VidBackgroundWithShards(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions,
+    const std::vector<HistogramStatistic> &statistics,
+    std::vector<TokenProcessorPack<HistogramShardAlgo<T>>> &processor_packs,
+    const int generator_threads,
+    const bool synchronous_allowed,
+    const std::shared_ptr<CvVidFramesGeneratorControl> &generator_control,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache/* = nullptr*/)
+{
+    // number of shards
+    int batch_size{static_cast<int>(processor_packs.size())};
+    assert(batch_size);
+
+    // frame generator packs (each batch holds one whole frame per shard, so frames are never chunked)
+    std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs{
+            GetBgGeneratorPacks(frame_source, vidbg_pack, frame_dimensions, batch_size, 1, generator_threads, generator_control, frame_cache)
+        };
+
+    // range of frames the histograms will cover (for the checkpoint)
+    const long long start_frame{generator_packs.front().start_frame};
+    const long long end_frame{generator_packs.back().last_frame};
+
+    // run the shards
+    const std::vector<const CvFrameSource*> pack_sources(generator_packs.size(), &frame_source);
+    auto histograms{VidHistogramsWithShards<T>(vidbg_pack, pack_sources, std::move(generator_packs), processor_packs, synchronous_allowed)};
+
+    // extract the background images
+    if (histograms)
+    {
+        // save the histograms so they can be merged with other ranges of frames later
+        if (!vidbg_pack.checkpoint_path.empty())
+        {
+            SaveHistogramCheckpoint(*histograms, start_frame, end_frame, vidbg_pack.checkpoint_path);
+
+            std::cout << "Saved background histograms of " << histograms->FramesCounted() << " frames to " <<
+                vidbg_pack.checkpoint_path << '\n';
+        }
+
+        // the generator and shard threads are idle now, so extraction can use all of them
+        histograms->SetExtractionThreads(batch_size + generator_threads);
+
+        return histograms->Statistics(statistics);
+    }
+    else
+        return std::vector<cv::Mat>{};
+}
+
+template <typename T>
+std::vector<cv::Mat> VidBackgroundRegionWithHistograms(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const BgThreadPlan &thread_plan,
+    const cv::Rect &frame_dimensions,
+    const std::vector<HistogramStatistic> &statistics,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache/* = nullptr*/)
+{
+    // compact histograms halve full bins instead of saturating them
+    const HistogramOverflow overflow_policy{vidbg_pack.compact_histograms ? HistogramOverflow::HALVE : HistogramOverflow::SATURATE};
 
-    if (batch_size <= 0)
+    // generators report how many frames they produced, and can be stopped early
+    auto generator_control{std::make_shared<CvVidFramesGeneratorControl>()};
+
+    // stop decoding once every processing unit's running median has converged
+    std::shared_ptr<HistogramConvergenceMonitor> convergence_monitor{};
+
+    if (vidbg_pack.convergence_check_interval > 0)
     {
-        batch_size = 1;
-        synchronous = true;
+        // shards only see every batch_size-th frame, so they check proportionally more often
+        int unit_check_interval{vidbg_pack.convergence_check_interval};
+
+        if (vidbg_pack.temporal_shards || !vidbg_pack.checkpoint_path.empty())
+            unit_check_interval = std::max(1, unit_check_interval / thread_plan.batch_size);
+
+        convergence_monitor = std::make_shared<HistogramConvergenceMonitor>(thread_plan.batch_size,
+            unit_check_interval,
+            vidbg_pack.convergence_tolerance,
+            [generator_control]() { generator_control->stop_requested = true; });
+    }
+
+    std::vector<cv::Mat> images{};
+
+    // checkpoints need the whole region's histograms in one place, which only the temporal shards produce
+    if (vidbg_pack.temporal_shards || !vidbg_pack.checkpoint_path.empty())
+    {
+        std::vector<TokenProcessorPack<HistogramShardAlgo<T>>> shard_packs;
+        shard_packs.reserve(thread_plan.batch_size);
+
+        for (int i{0}; i < thread_plan.batch_size; i++)
+            shard_packs.emplace_back(TokenProcessorPack<HistogramShardAlgo<T>>{overflow_policy, convergence_monitor});
+
+        images = VidBackgroundWithShards<T>(frame_source,
+            vidbg_pack,
+            frame_dimensions,
+            statistics,
+            shard_packs,
+            thread_plan.generator_threads,
+            thread_plan.synchronous,
+            generator_control,
+            frame_cache);
     }
     else
     {
-        // divide available threads between the token generator and processor: HEURISTIC
-        int total_threads = generator_threads + batch_size;
-        generator_threads = total_threads / 2;
-        batch_size = total_threads - generator_threads;     //processor gets extra thread in case of odd total number
+        // each processing unit extracts all the statistics for its strip of the frame
+        std::vector<TokenProcessorPack<HistogramMedianAlgo<T>>> processor_packs;
+        processor_packs.reserve(thread_plan.batch_size);
+
+        for (int i{0}; i < thread_plan.batch_size; i++)
+            processor_packs.emplace_back(TokenProcessorPack<HistogramMedianAlgo<T>>{statistics, overflow_policy, convergence_monitor});
+
+        cv::Mat stacked_images{VidBackgroundWithAlgo<HistogramMedianAlgo<T>>(frame_source,
+            vidbg_pack,
+            frame_dimensions,
+            processor_packs,
+            thread_plan.generator_threads,
+            thread_plan.synchronous,
+            generator_control,
+            frame_cache)};
+
+        // separate the statistic images (they were stacked as channel groups)
+        if (!stacked_images.empty())
+            EXCEPTION_ASSERT(cv_mats_from_channel_stack(stacked_images, statistics.empty() ? 1 : static_cast<int>(statistics.size()), images));
     }
 
-    assert(generator_threads);
-    assert(batch_size);
+    // report how many frames went into the background
+    if (convergence_monitor)
+    {
+        std::cout << "Background " << (convergence_monitor->HasConverged() ? "converged" : "did not converge") <<
+            " after " << generator_control->frames_generated << " frames\n";
+    }
 
-    std::vector<TokenProcessorPack<MedianAlgo>> empty_packs;
-    empty_packs.resize(batch_size, TokenProcessorPack<MedianAlgo>{});
+    if (vidbg_pack.dedup_threshold > 0.0)
+        std::cout << "Background skipped " << generator_control->frames_skipped << " near-duplicate frames\n";
 
-    return VidBackgroundWithAlgo<MedianAlgo>(vid, vidbg_pack, empty_packs, generator_threads, synchronous);
+    if (generator_control->frames_dropped > 0)
+        std::cerr << "warning, background is missing " << generator_control->frames_dropped << " sampled frames that could not be reached\n";
+
+    // the frame cache only holds every frame if decoding wasn't stopped early (it checks for gaps itself)
+    if (frame_cache)
+        frame_cache->Finish(!images.empty() && !generator_control->stop_requested);
+
+    return images;
 }
 
-/// get a video background
-cv::Mat GetVideoBackground(const VidBgPack &vidbg_pack)
+/// get a writer for the pack's frame cache, if the background's decoding pass can fill it
+/// - the pass must decode every frame from the start of the video, as cropped grayscale frames
+static std::shared_ptr<CvFrameCacheWriter> GetBgFrameCacheWriter(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions)
 {
-    // open video file
-    cv::VideoCapture vid{vidbg_pack.vid_path};
+    if (vidbg_pack.frame_cache_path.empty() ||
+        frame_source.type != CvFrameSourceType::VIDEO ||
+        !(vidbg_pack.grayscale || vidbg_pack.vid_is_grayscale) ||
+        vidbg_pack.start_frame != 0 ||
+        vidbg_pack.sample_frames > 0)
+        return nullptr;
+
+    // the frame index counts the frames, the container only estimates them (and a cache that holds fewer frames than
+    //   its capacity is never published)
+    long long frame_count{frame_source.frame_count};
+    CvVidFrameIndex frame_index{};
+
+    if (vidbg_pack.use_frame_index && cv_vid_frame_index(frame_source.path, frame_index))
+        frame_count = frame_index.frame_count;
+
+    const long long frame_capacity{vidbg_pack.frame_limit > 0 ?
+        std::min(vidbg_pack.frame_limit, frame_count) :
+        frame_count};
+
+    if (frame_capacity <= 0)
+        return nullptr;
+
+    auto frame_cache{std::make_shared<CvFrameCacheWriter>(vidbg_pack.frame_cache_path,
+        cv_frame_cache_key(frame_source.path, frame_dimensions, vidbg_pack.vid_is_grayscale, vidbg_pack.decode_luma),
+        frame_dimensions.width,
+        frame_dimensions.height,
+        frame_capacity,
+        vidbg_pack.frame_limit > 0 ? vidbg_pack.frame_limit : -1,
+        frame_source.fps)};
 
-    if (!vid.isOpened())
+    if (!frame_cache->IsOpen())
     {
-        std::cerr << "Video file not detected: " << vidbg_pack.vid_path << '\n';
+        std::cerr << "warning, could not create frame cache (or not enough disk space): " << vidbg_pack.frame_cache_path << '\n';
 
-        return cv::Mat{};
+        return nullptr;
     }
 
-    // print info about the video
-    long long total_frames{static_cast<long long>(vid.get(cv::CAP_PROP_FRAME_COUNT))};
+    return frame_cache;
+}
 
-    std::cout << "Frames: " << total_frames <<
-                  "; Res: " << vid.get(cv::CAP_PROP_FRAME_WIDTH) << 'x' << vid.get(cv::CAP_PROP_FRAME_HEIGHT);
+template <typename T>
+std::vector<cv::Mat> VidBackgroundWithHistograms(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const std::vector<HistogramStatistic> &statistics)
+{
+    // divide threads between the frame generator and the processing units
+    BgThreadPlan thread_plan{GetBgThreadPlan(vidbg_pack)};
 
-    if (vidbg_pack.crop_x || vidbg_pack.crop_y || vidbg_pack.crop_width || vidbg_pack.crop_height)
+    cv::Rect frame_dimensions{GetSourceFrameDims(frame_source, vidbg_pack.crop_x, vidbg_pack.crop_y, vidbg_pack.crop_width, vidbg_pack.crop_height)};
+
+    // split the region into stripes that fit in the memory limit
+    std::vector<cv::Rect> stripes{GetBgMemoryStripes(vidbg_pack, thread_plan, frame_dimensions, static_cast<int>(sizeof(T)))};
+    assert(stripes.size());
+
+    if (stripes.size() == 1)
     {
-        cv::Rect frame_dimensions{GetCroppedFrameDims(vidbg_pack.crop_x, vidbg_pack.crop_y, vidbg_pack.crop_width, vidbg_pack.crop_height,
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_WIDTH)),
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_HEIGHT)))};
+        return VidBackgroundRegionWithHistograms<T>(frame_source,
+            vidbg_pack,
+            thread_plan,
+            stripes.front(),
+            statistics,
+            GetBgFrameCacheWriter(frame_source, vidbg_pack, frame_dimensions));
+    }
 
-        std::cout << "(" << frame_dimensions.width << 'x' << frame_dimensions.height << " cropped)";
+    // a checkpoint holds the histograms of one region
+    EXCEPTION_ASSERT_MSG(vidbg_pack.checkpoint_path.empty(), "background checkpoints can't be saved when the memory limit requires stripes");
+    // each stripe would compare only its own rows, so stripes could keep different frames
+    EXCEPTION_ASSERT_MSG(vidbg_pack.dedup_threshold <= 0.0, "frames can't be deduplicated when the memory limit requires stripes");
+
+    // collect each stripe's images (one decode pass per stripe)
+    std::vector<std::vector<cv::Mat>> stripe_images{};
+    stripe_images.reserve(stripes.size());
+
+    for (std::size_t stripe_index{0}; stripe_index < stripes.size(); stripe_index++)
+    {
+        if (vidbg_pack.print_timing_report)
+            std::cout << "Background stripe " << stripe_index + 1 << '/' << stripes.size() << '\n';
+
+        stripe_images.emplace_back(VidBackgroundRegionWithHistograms<T>(frame_source, vidbg_pack, thread_plan, stripes[stripe_index], statistics));
+
+        // a failed stripe means the background can't be assembled
+        if (stripe_images.back().empty() || stripe_images.back().size() != stripe_images.front().size())
+            return std::vector<cv::Mat>{};
+    }
+
+    // stack the stripes back together for each statistic
+    std::vector<cv::Mat> images{};
+    images.resize(stripe_images.front().size());
+
+    for (std::size_t image_index{0}; image_index < images.size(); image_index++)
+    {
+        std::vector<cv::Mat> stripes_of_image{};
+        stripes_of_image.reserve(stripe_images.size());
+
+        for (auto &image_set : stripe_images)
+            stripes_of_image.emplace_back(std::move(image_set[image_index]));
+
+        cv::vconcat(stripes_of_image, images[image_index]);
+    }
+
+    return images;
+}
+
+/// get video background images by analyzing the video
+/// - reads the frames from the pack's frame cache if it has them
+static std::vector<cv::Mat> GetVideoBackgroundsUncached(CvFrameSource frame_source,
+    const VidBgPack &vidbg_pack,
+    const std::vector<HistogramStatistic> &statistics,
+    long long total_frames)
+{
+    if (!vidbg_pack.frame_cache_path.empty() &&
+        frame_source.type == CvFrameSourceType::VIDEO &&
+        (vidbg_pack.grayscale || vidbg_pack.vid_is_grayscale))
+    {
+        const cv::Rect frame_dimensions{GetCroppedFrameDims(vidbg_pack.crop_x, vidbg_pack.crop_y, vidbg_pack.crop_width, vidbg_pack.crop_height,
+            frame_source.frame_width,
+            frame_source.frame_height)};
+
+        // sampling spreads frames across the whole video
+        const long long min_frames{vidbg_pack.sample_frames <= 0 && vidbg_pack.frame_limit > 0 ?
+            vidbg_pack.start_frame + vidbg_pack.frame_limit :
+            -1};
+
+        if (cv_open_frame_cache(vidbg_pack.frame_cache_path,
+                cv_frame_cache_key(frame_source.path, frame_dimensions, vidbg_pack.vid_is_grayscale, vidbg_pack.decode_luma),
+                frame_dimensions,
+                min_frames,
+                frame_source))
+        {
+            std::cout << "Frames read from cache: " << vidbg_pack.frame_cache_path << '\n';
+            total_frames = frame_source.frame_count;
+        }
     }
-    std::cout << "; FPS: " << vid.get(cv::CAP_PROP_FPS) << '\n';
 
     // figure out how many frames will be analyzed
-    long long frames_to_analyze{vidbg_pack.frame_limit};
+    long long frames_to_analyze{vidbg_pack.sample_frames > 0 ? vidbg_pack.sample_frames : vidbg_pack.frame_limit};
 
-    if (frames_to_analyze <= 0 || frames_to_analyze > total_frames)
-        frames_to_analyze = total_frames;
+    if (frames_to_analyze <= 0 || frames_to_analyze > total_frames - vidbg_pack.start_frame)
+        frames_to_analyze = total_frames - vidbg_pack.start_frame;
 
     // algo is user-specified
     switch (GetBGAlgo(vidbg_pack.bg_algo))
     {
         case BGAlgo::HISTOGRAM :
         {
-            // use cheapest histogram algorithm
-            if (frames_to_analyze <= static_cast<long long>(static_cast<unsigned char>(-1)))
+            // use cheapest histogram algorithm (compact histograms handle any number of frames with 8-bit bins)
+            if (vidbg_pack.compact_histograms ||
+                frames_to_analyze <= static_cast<long long>(static_cast<unsigned char>(-1)))
             {
-                return VidBackgroundWithAlgoEmptyPacks<HistogramMedianAlgo8>(vid, vidbg_pack);
+                return VidBackgroundWithHistograms<unsigned char>(frame_source, vidbg_pack, statistics);
             }
             else if (frames_to_analyze <= static_cast<long long>(static_cast<std::uint16_t>(-1)))
             {
-                return VidBackgroundWithAlgoEmptyPacks<HistogramMedianAlgo16>(vid, vidbg_pack);
+                return VidBackgroundWithHistograms<std::uint16_t>(frame_source, vidbg_pack, statistics);
             }
             else if (frames_to_analyze <= static_cast<long long>(static_cast<std::uint32_t>(-1)))
             {
-                return VidBackgroundWithAlgoEmptyPacks<HistogramMedianAlgo32>(vid, vidbg_pack);
+                return VidBackgroundWithHistograms<std::uint32_t>(frame_source, vidbg_pack, statistics);
             }
             else
             {
@@ -256,29 +1000,274 @@ cv::Mat GetVideoBackground(const VidBgPack &vidbg_pack)
         {
             std::cerr << "tried to get vid background with unknown algorithm: " << vidbg_pack.bg_algo << '\n';
 
-            return cv::Mat{};
+            return std::vector<cv::Mat>{};
         }
     };
 
-    return cv::Mat{};
+    return std::vector<cv::Mat>{};
 }
 
+/// get video background images
+std::vector<cv::Mat> GetVideoBackgrounds(const VidBgPack &vidbg_pack)
+{
+    // open video file (or other source of frames)
+    CvFrameSource frame_source{};
 
+    if (!cv_open_frame_source(vidbg_pack.vid_path, vidbg_pack.raw_format, frame_source))
+    {
+        std::cerr << "Frame source not detected: " << vidbg_pack.vid_path << '\n';
 
+        return std::vector<cv::Mat>{};
+    }
 
+    // statistics to extract (validate them before doing any work)
+    const std::vector<HistogramStatistic> statistics{GetHistogramStatistics(vidbg_pack.statistics)};
 
+    // print info about the video
+    long long total_frames{frame_source.frame_count};
 
+    std::cout << "Frames: " << total_frames <<
+                  "; Res: " << frame_source.frame_width << 'x' << frame_source.frame_height;
 
+    if (vidbg_pack.crop_x || vidbg_pack.crop_y || vidbg_pack.crop_width || vidbg_pack.crop_height)
+    {
+        cv::Rect frame_dimensions{GetCroppedFrameDims(vidbg_pack.crop_x, vidbg_pack.crop_y, vidbg_pack.crop_width, vidbg_pack.crop_height,
+        frame_source.frame_width,
+        frame_source.frame_height)};
 
+        std::cout << "(" << frame_dimensions.width << 'x' << frame_dimensions.height << " cropped)";
+    }
+    std::cout << "; FPS: " << frame_source.fps << '\n';
 
+    // the cache fingerprints videos by decoding a few of their frames, so other sources aren't cached
+    if (!vidbg_pack.cache_dir.empty() && frame_source.type != CvFrameSourceType::VIDEO)
+        std::cerr << "warning, backgrounds are only cached for videos\n";
 
+    // look for cached images (a checkpoint can only be made by analyzing the video)
+    if (!vidbg_pack.cache_dir.empty() && frame_source.type == CvFrameSourceType::VIDEO)
+    {
+        cv::Rect frame_dimensions{GetCroppedFrameDims(vidbg_pack.crop_x, vidbg_pack.crop_y, vidbg_pack.crop_width, vidbg_pack.crop_height,
+            frame_source.frame_width,
+            frame_source.frame_height)};
+        cv::VideoCapture vid{frame_source.path};
+        const VidBgCacheKey cache_key{GetVidBgCacheKey(vid, vidbg_pack)};
+        std::vector<cv::Mat> cached_images{};
+
+        if (vidbg_pack.checkpoint_path.empty() &&
+            LoadCachedVidBackgrounds(vidbg_pack.cache_dir, cache_key, frame_dimensions, vidbg_pack.statistics, cached_images))
+        {
+            std::cout << "Background found in cache: " << vidbg_pack.cache_dir << '\n';
 
+            return cached_images;
+        }
 
+        // compute the images, then cache them
+        std::vector<cv::Mat> images{GetVideoBackgroundsUncached(frame_source, vidbg_pack, statistics, total_frames)};
+        SaveCachedVidBackgrounds(vidbg_pack.cache_dir, cache_key, frame_dimensions, vidbg_pack.statistics, images);
 
+        return images;
+    }
+
+    return GetVideoBackgroundsUncached(frame_source, vidbg_pack, statistics, total_frames);
+}
+
+/// get a video background
+cv::Mat GetVideoBackground(const VidBgPack &vidbg_pack)
+{
+    std::vector<cv::Mat> images{GetVideoBackgrounds(vidbg_pack)};
+
+    if (images.empty())
+        return cv::Mat{};
+    else
+        return std::move(images.front());
+}
+
+template <typename T>
+static std::vector<cv::Mat> VidSetBackgroundWithHistograms(const std::vector<CvFrameSource> &frame_sources,
+    const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions,
+    const std::vector<HistogramStatistic> &statistics)
+{
+    // divide threads between the frame generators and the shards
+    const BgThreadPlan thread_plan{GetBgThreadPlan(vidbg_pack)};
+
+    // compact histograms halve full bins instead of saturating them
+    const HistogramOverflow overflow_policy{vidbg_pack.compact_histograms ? HistogramOverflow::HALVE : HistogramOverflow::SATURATE};
+
+    auto generator_control{std::make_shared<CvVidFramesGeneratorControl>()};
+    ElementHistograms<T> merged{overflow_policy};
+
+    // decode 'generator_threads' videos at a time (one generator each), summing each wave's histograms
+    for (std::size_t wave_begin{0}; wave_begin < frame_sources.size(); wave_begin += thread_plan.generator_threads)
+    {
+        const std::size_t wave_end{std::min(frame_sources.size(), wave_begin + thread_plan.generator_threads)};
 
+        std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs{};
+        std::vector<const CvFrameSource*> pack_sources{};
+        generator_packs.reserve(wave_end - wave_begin);
+        pack_sources.reserve(wave_end - wave_begin);
 
+        for (std::size_t vid_index{wave_begin}; vid_index < wave_end; vid_index++)
+        {
+            std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> vid_packs{
+                    GetBgGeneratorPacks(frame_sources[vid_index], vidbg_pack, frame_dimensions, thread_plan.batch_size, 1, 1, generator_control)
+                };
+
+            for (auto &vid_pack : vid_packs)
+            {
+                generator_packs.emplace_back(std::move(vid_pack));
+                pack_sources.emplace_back(&frame_sources[vid_index]);
+            }
+        }
 
+        std::vector<TokenProcessorPack<HistogramShardAlgo<T>>> shard_packs;
+        shard_packs.reserve(thread_plan.batch_size);
 
+        for (int i{0}; i < thread_plan.batch_size; i++)
+            shard_packs.emplace_back(TokenProcessorPack<HistogramShardAlgo<T>>{overflow_policy, nullptr});
 
+        auto histograms{VidHistogramsWithShards<T>(vidbg_pack, pack_sources, std::move(generator_packs), shard_packs, thread_plan.synchronous)};
 
+        if (histograms)
+            merged.Merge(*histograms);
+    }
 
+    std::cout << "Background of " << frame_sources.size() << " videos from " << merged.FramesCounted() << " frames\n";
+
+    if (vidbg_pack.dedup_threshold > 0.0)
+        std::cout << "Background skipped " << generator_control->frames_skipped << " near-duplicate frames\n";
+
+    if (generator_control->frames_dropped > 0)
+        std::cerr << "warning, background is missing " << generator_control->frames_dropped << " sampled frames that could not be reached\n";
+
+    // the generator and shard threads are idle now, so extraction can use all of them
+    merged.SetExtractionThreads(thread_plan.batch_size + thread_plan.generator_threads);
+
+    return merged.Statistics(statistics);
+}
+
+/// get background images of a set of videos with the same frame size
+std::vector<cv::Mat> GetVideoSetBackgrounds(const std::vector<std::string> &vid_paths, const VidBgPack &vidbg_pack)
+{
+    EXCEPTION_ASSERT_MSG(vid_paths.size(), "no videos for the background");
+
+    // statistics to extract (validate them before doing any work)
+    const std::vector<HistogramStatistic> statistics{GetHistogramStatistics(vidbg_pack.statistics)};
+
+    // all videos must have the same frame size, and the histograms must hold all their frames
+    // - videos decoded at the same time share a frame generator, so they must be the same kind of source
+    std::vector<CvFrameSource> frame_sources(vid_paths.size());
+    cv::Size frame_size{};
+    long long frames_to_analyze{0};
+
+    for (std::size_t vid_index{0}; vid_index < vid_paths.size(); vid_index++)
+    {
+        const std::string &vid_path{vid_paths[vid_index]};
+        CvFrameSource &frame_source{frame_sources[vid_index]};
+        EXCEPTION_ASSERT_MSG(cv_open_frame_source(vid_path, vidbg_pack.raw_format, frame_source), "frame source not detected: " + vid_path);
+        EXCEPTION_ASSERT_MSG(frame_source.type == frame_sources.front().type, "videos for one background must be the same kind of source: " + vid_path);
+
+        const cv::Size vid_frame_size{frame_source.frame_width, frame_source.frame_height};
+
+        if (frame_size.area() == 0)
+            frame_size = vid_frame_size;
+
+        EXCEPTION_ASSERT_MSG(vid_frame_size == frame_size, "videos for one background must have the same frame size: " + vid_path);
+
+        // the frame limit and sampling apply to each video
+        const long long total_frames{frame_source.frame_count};
+        long long vid_frames{vidbg_pack.sample_frames > 0 ? vidbg_pack.sample_frames : vidbg_pack.frame_limit};
+
+        if (vid_frames <= 0 || vid_frames > total_frames - vidbg_pack.start_frame)
+            vid_frames = total_frames - vidbg_pack.start_frame;
+
+        frames_to_analyze += vid_frames;
+    }
+
+    cv::Rect frame_dimensions{GetCroppedFrameDims(vidbg_pack.crop_x, vidbg_pack.crop_y, vidbg_pack.crop_width, vidbg_pack.crop_height,
+        frame_size.width,
+        frame_size.height)};
+
+    std::cout << "Videos: " << vid_paths.size() << "; Frames: " << frames_to_analyze <<
+        "; Res: " << frame_dimensions.width << 'x' << frame_dimensions.height << '\n';
+
+    EXCEPTION_ASSERT_MSG(GetBGAlgo(vidbg_pack.bg_algo) == BGAlgo::HISTOGRAM, "unknown background algorithm: " + vidbg_pack.bg_algo);
+
+    // use cheapest histogram type (compact histograms handle any number of frames with 8-bit bins)
+    if (vidbg_pack.compact_histograms ||
+        frames_to_analyze <= static_cast<long long>(static_cast<unsigned char>(-1)))
+        return VidSetBackgroundWithHistograms<unsigned char>(frame_sources, vidbg_pack, frame_dimensions, statistics);
+    else if (frames_to_analyze <= static_cast<long long>(static_cast<std::uint16_t>(-1)))
+        return VidSetBackgroundWithHistograms<std::uint16_t>(frame_sources, vidbg_pack, frame_dimensions, statistics);
+    else if (frames_to_analyze <= static_cast<long long>(static_cast<std::uint32_t>(-1)))
+        return VidSetBackgroundWithHistograms<std::uint32_t>(frame_sources, vidbg_pack, frame_dimensions, statistics);
+
+    std::cerr << "warning, videos have over 2^32 frames! (" << frames_to_analyze << ") is way too many!\n";
+
+    return std::vector<cv::Mat>{};
+}
+
+template <typename T>
+static std::vector<cv::Mat> MergeCheckpointsWithHistograms(const std::vector<std::string> &checkpoint_paths,
+    const std::vector<HistogramStatistic> &statistics,
+    const HistogramOverflow overflow_policy,
+    const int max_threads)
+{
+    ElementHistograms<T> merged{overflow_policy};
+
+    for (const auto &path : checkpoint_paths)
+    {
+        ElementHistograms<T> checkpoint{LoadHistogramCheckpoint<T>(path)};
+        merged.Merge(checkpoint);
+    }
+
+    merged.SetExtractionThreads(std::max(1, max_threads));
+
+    return merged.Statistics(statistics);
+}
+
+/// get background images from the sum of several histogram checkpoints
+std::vector<cv::Mat> MergeBackgroundCheckpoints(const std::vector<std::string> &checkpoint_paths,
+    const std::vector<std::string> &statistics,
+    const int max_threads)
+{
+    EXCEPTION_ASSERT_MSG(checkpoint_paths.size(), "no background checkpoints to merge");
+
+    // statistics to extract (validate them before doing any work)
+    const std::vector<HistogramStatistic> histogram_statistics{GetHistogramStatistics(statistics)};
+
+    // the checkpoints must cover the same region, and the merged histograms must hold all their frames
+    const HistogramCheckpointHeader first_header{ReadHistogramCheckpointHeader(checkpoint_paths.front())};
+    long long total_frames{0};
+    bool any_halved{false};
+
+    for (const auto &path : checkpoint_paths)
+    {
+        const HistogramCheckpointHeader header{ReadHistogramCheckpointHeader(path)};
+
+        EXCEPTION_ASSERT_MSG(header.rows == first_header.rows &&
+                header.cols == first_header.cols &&
+                header.channels == first_header.channels,
+            "background checkpoints have different dimensions: " + path);
+
+        total_frames += header.frames_counted;
+        any_halved = any_halved || header.overflow_policy == 1;
+    }
+
+    std::cout << "Merging " << checkpoint_paths.size() << " background checkpoints (" << total_frames << " frames)\n";
+
+    // use cheapest histogram type (halved histograms only hold relative counts, so they stay 8-bit)
+    if (any_halved || total_frames <= static_cast<long long>(static_cast<unsigned char>(-1)))
+        return MergeCheckpointsWithHistograms<unsigned char>(checkpoint_paths,
+            histogram_statistics,
+            any_halved ? HistogramOverflow::HALVE : HistogramOverflow::SATURATE,
+            max_threads);
+    else if (total_frames <= static_cast<long long>(static_cast<std::uint16_t>(-1)))
+        return MergeCheckpointsWithHistograms<std::uint16_t>(checkpoint_paths, histogram_statistics, HistogramOverflow::SATURATE, max_threads);
+    else if (total_frames <= static_cast<long long>(static_cast<std::uint32_t>(-1)))
+        return MergeCheckpointsWithHistograms<std::uint32_t>(checkpoint_paths, histogram_statistics, HistogramOverflow::SATURATE, max_threads);
+
+    std::cerr << "warning, background checkpoints have over 2^32 frames! (" << total_frames << ") is way too many!\n";
+
+    return std::vector<cv::Mat>{};
+}
@@ -4,12 +4,18 @@
 #define CV_VID_BG_HELPERS_0089787_H
 
 //local headers
+#include "cv_frame_cache.h"
+#include "cv_frame_source.h"
+#include "cv_vid_frames_generator_algo.h"
+#include "histogram_shard_algo.h"
+#include "token_batch_generator.h"
 #include "token_processor_algo.h"
 
 //third party headers
 #include <opencv2/opencv.hpp>   //for video manipulation (mainly)
 
 //standard headers
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -26,57 +32,245 @@ enum class BGAlgo
 /// get background algo from string
 BGAlgo GetBGAlgo(const std::string &algo);
 
+/// get histogram statistic from string
+/// - 'median', 'pNN' (NN-th percentile, e.g. 'p10', 'p97.5'), 'mode', 'mean', 'tmeanNN' (mean with NN% trimmed from each tail)
+/// - dispersion (noise) images: 'iqr' (interquartile range), 'mad' (median absolute deviation)
+HistogramStatistic GetHistogramStatistic(const std::string &statistic);
+
+/// get histogram statistics from strings (an empty set means 'median only')
+std::vector<HistogramStatistic> GetHistogramStatistics(const std::vector<std::string> &statistics);
+
 /// settings necessary to get a vid background
+/// - fields aren't const, so a pack can also be built by naming each field (see GetTrackingBackgrounds())
 struct VidBgPack
 {
-    // path to video
-    const std::string vid_path{};
+    // path to video (a directory of images, a .y4m file, or a raw frame file with raw_format also work, see cv_open_frame_source())
+    std::string vid_path{};
     // algorithm to use for getting vid bg
-    const std::string bg_algo{};
+    std::string bg_algo{};
     // max number of threads allowed
-    const int max_threads{};
+    int max_threads{};
 
     // max number of frames to analyze for getting the vig bg (<= 0 means use all frames in video)
-    const long long frame_limit{-1};
+    long long frame_limit{-1};
     // whether to convert frames to grayscale before analyzing them
-    const bool grayscale{false};
+    bool grayscale{false};
     // whether video is already supposedly grayscale
-    const bool vid_is_grayscale{false};
+    bool vid_is_grayscale{false};
 
     // x-position of frame-crop region
-    const int crop_x{0};
+    int crop_x{0};
     // y-position of frame-crop region
-    const int crop_y{0};
+    int crop_y{0};
     // width of frame-crop region
-    const int crop_width{0};
+    int crop_width{0};
     // height of frame-crop region
-    const int crop_height{0};
+    int crop_height{0};
 
     // max number of input fragments to store at a time (memory conservation vs efficiency)
-    const int token_storage_limit{-1};
+    int token_storage_limit{-1};
 
     // whether to collect and print timing reports
-    const bool print_timing_report{false};
+    bool print_timing_report{false};
+
+    // whether each processing unit should histogram whole frames (temporal shards) instead of a strip of every frame
+    // - the shards' histograms are summed before the background is extracted
+    // - WARNING: every shard holds histograms for the full frame, which multiplies histogram RAM by the number of shards
+    bool temporal_shards{false};
+
+    // statistics to extract from the pixel histograms, one background image each (see GetHistogramStatistic())
+    // - all statistics come from the same pass over the video; empty means 'median only'
+    std::vector<std::string> statistics{};
+
+    // max RAM (MB) the pixel histograms may use (<= 0 means no limit)
+    // - if the histograms for the whole crop region won't fit, the region is processed in horizontal stripes,
+    //   with one decode pass over the video per stripe
+    long long memory_limit_mb{0};
+
+    // whether to always use 8-bit histogram bins, halving a pixel's histogram when one of its bins fills up
+    // - statistics only need relative counts, so this costs little accuracy and uses 1/2 or 1/4 of the RAM for long videos
+    bool compact_histograms{false};
+
+    // number of frames between checks of the running median (<= 0 means always use all frames)
+    // - frame decoding stops early once the running median changes less than the tolerance between checks
+    int convergence_check_interval{0};
+    // max mean change of the running median (in pixel value levels) between checks for it to count as converged
+    double convergence_tolerance{0.5};
+
+    // number of frames to sample from across the whole video (<= 0 means analyze consecutive frames; overrides frame_limit)
+    // - frames far apart are reached by seeking, so the frames in between are not decoded
+    long long sample_frames{0};
+    // seed for picking the sampled frames at random (< 0 means spread them uniformly)
+    long long sample_seed{-1};
+
+    // first frame to analyze (frame_limit and sample_frames apply to the frames after it)
+    long long start_frame{0};
+    // file to save the pixel histograms to before the background is extracted (empty means no checkpoint)
+    // - written once, when the pass finishes (an interrupted pass leaves no checkpoint)
+    // - see MergeBackgroundCheckpoints(); implies temporal shards, and can't be combined with a memory limit that needs stripes
+    std::string checkpoint_path{};
+
+    // directory for caching background images between calls (empty means no cache)
+    // - images are keyed by a fingerprint of the video plus the settings that affect them; images of the whole frame
+    //   also serve any crop region
+    std::string cache_dir{};
+
+    // drop frames whose mean absolute difference from the last analyzed frame is at or below this, in pixel value
+    //   levels (<= 0 means analyze every frame)
+    // - long runs of near-identical frames would otherwise outweigh the rest of the video in the statistics
+    // - can't be combined with a memory limit that needs stripes
+    double dedup_threshold{0.0};
+
+    // whether to index the video's keyframes (stored in a sidecar file next to the video, see cv_vid_frame_index())
+    // - seeks (start_frame, sampling, parallel workers) become exact, the frame count is counted instead of estimated,
+    //   and workers' frame ranges start on keyframes
+    bool use_frame_index{false};
+
+    // with grayscale or vid_is_grayscale: take the luma plane of the decoded frames instead of converting them to BGR and back
+    // - luma levels can differ slightly from BGR->gray levels, so compare the background with frames decoded the same way
+    bool decode_luma{false};
+
+    // rows in the grid each frame is split into when several threads run a parallel background algo (<= 0 means one
+    //   horizontal strip per thread; 1 means vertical column strips)
+    // - reduced to the nearest count that divides the number of threads; row strips copy and scan faster than columns
+    int chunk_rows{0};
+
+    // layout of headerless raw frame files, 'WxH:fmt' (fmt: gray8, bgr24, yuv420p, yuv422p, yuv444p; empty means vid_path
+    //   is a video, an image directory, or a .y4m file)
+    // - raw frames are read straight from a memory mapping, skipping decoding entirely
+    std::string raw_format{};
+
+    // file for caching the video's cropped grayscale frames, so later passes over the video (e.g. TrackObjects()) read
+    //   them instead of decoding the video again (empty means no cache; see cv_frame_cache.h)
+    // - written while the background is computed if every frame from frame 0 is decoded (no start frame, sampling, or
+    //   early convergence stop); read instead of the video if it was made from the same video, crop, and grayscale mode
+    std::string frame_cache_path{};
+
+    // max number of threads each video decoder may use internally (<= 0 means the decoder backend's default, which can
+    //   oversubscribe the cores)
+    // - with a fixed count (at most the generator threads), fewer frame generator workers are started so their decoders
+    //   fit in the generator threads
+    int decoder_threads{0};
+};
+
+/// how available threads are divided between frame generation and frame processing
+struct BgThreadPlan
+{
+    // number of frame generator threads (each worker decodes its own range of frames; see VidBgPack::decoder_threads)
+    int generator_threads{1};
+    // number of processing units
+    int batch_size{1};
+    // whether the processing units should run synchronously
+    bool synchronous{false};
 };
 
+/// divide available threads between frame generator workers and processing units
+BgThreadPlan GetBgThreadPlan(const VidBgPack &vidbg_pack);
+
 /// get a frame crop rectangle from inputs
 cv::Rect GetCroppedFrameDims(int x, int y, int width, int height, int hor_pixels, int vert_pixels);
 
+/// get the crop rectangle of a frame source's frames from inputs (see GetCroppedFrameDims())
+/// - the frames of pre-cropped sources (e.g. a frame cache) are the crop region, so the rectangle is the whole frame
+cv::Rect GetSourceFrameDims(const CvFrameSource &frame_source, int x, int y, int width, int height);
+
+/// estimate the histogram RAM (bytes) needed for one row of the crop region
+long long GetBgHistogramBytesPerRow(const VidBgPack &vidbg_pack,
+    const BgThreadPlan &thread_plan,
+    const int crop_width,
+    const int histogram_element_bytes);
+
+/// split a crop region into horizontal stripes whose histograms fit in the memory limit
+/// - returns the whole crop region if there is no limit or it already fits
+std::vector<cv::Rect> GetBgMemoryStripes(const VidBgPack &vidbg_pack,
+    const BgThreadPlan &thread_plan,
+    const cv::Rect &frame_dimensions,
+    const int histogram_element_bytes);
+
 /// encapsulates call to async tokenized video background analysis
 template <typename MedianAlgo>
-cv::Mat VidBackgroundWithAlgo(cv::VideoCapture &vid,
+cv::Mat VidBackgroundWithAlgo(const CvFrameSource &frame_source,
     const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions,
     std::vector<TokenProcessorPack<MedianAlgo>> &processor_packs,
     const int generator_threads,
-    const bool synchronous_allowed);
+    const bool synchronous_allowed,
+    const std::shared_ptr<CvVidFramesGeneratorControl> &generator_control,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache = nullptr);
+
+/// pick frames to sample from a video (sorted; uniformly spread if the seed is < 0, otherwise at random)
+std::vector<long long> GetBgSampleFrames(const long long total_frames, const long long sample_frames, const long long sample_seed);
+
+/// start a frame generator with one worker per pack, reading each pack's frames from its source
+/// - the sources must be the same kind (see cv_open_frame_source()), and outlive the generator
+std::shared_ptr<TokenBatchGenerator<cv::Mat>> StartFramesGenerator(const std::vector<const CvFrameSource*> &pack_sources,
+    std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs,
+    const int batch_size,
+    const bool collect_timings,
+    const int token_storage_limit);
+
+/// start a frame generator with one worker per pack, all reading from one source (see above)
+std::shared_ptr<TokenBatchGenerator<cv::Mat>> StartFramesGenerator(const CvFrameSource &frame_source,
+    std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs,
+    const int batch_size,
+    const bool collect_timings,
+    const int token_storage_limit);
+
+/// get frame generator packs that split the frames to analyze into contiguous ranges (one range per generator thread)
+std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> GetBgGeneratorPacks(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions,
+    const int frames_in_batch,
+    const int chunks_per_frame,
+    const int generator_threads,
+    const std::shared_ptr<CvVidFramesGeneratorControl> &generator_control,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache = nullptr);
 
-/// encapsulates call to async tokenized video background analysis using empty processor packs
-template <typename MedianAlgo>
-cv::Mat VidBackgroundWithAlgoEmptyPacks(cv::VideoCapture &vid, const VidBgPack &vidbg_pack);
+/// encapsulates call to async tokenized video background analysis with temporal shards (histograms merged before extraction)
+template <typename T>
+std::vector<cv::Mat> VidBackgroundWithShards(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const cv::Rect &frame_dimensions,
+    const std::vector<HistogramStatistic> &statistics,
+    std::vector<TokenProcessorPack<HistogramShardAlgo<T>>> &processor_packs,
+    const int generator_threads,
+    const bool synchronous_allowed,
+    const std::shared_ptr<CvVidFramesGeneratorControl> &generator_control,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache = nullptr);
+
+/// get video background images (one per statistic) of a region with histograms of type T (uses temporal shards if requested)
+template <typename T>
+std::vector<cv::Mat> VidBackgroundRegionWithHistograms(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const BgThreadPlan &thread_plan,
+    const cv::Rect &frame_dimensions,
+    const std::vector<HistogramStatistic> &statistics,
+    const std::shared_ptr<CvFrameCacheWriter> &frame_cache = nullptr);
+
+/// get video background images (one per statistic) with histograms of type T
+/// - processes the crop region in stripes if its histograms won't fit in the memory limit
+template <typename T>
+std::vector<cv::Mat> VidBackgroundWithHistograms(const CvFrameSource &frame_source,
+    const VidBgPack &vidbg_pack,
+    const std::vector<HistogramStatistic> &statistics);
+
+/// get video background images, one per requested statistic (in the order requested)
+std::vector<cv::Mat> GetVideoBackgrounds(const VidBgPack &vidbg_pack);
 
-/// get a video background
+/// get a video background (the first requested statistic)
 cv::Mat GetVideoBackground(const VidBgPack &vidbg_pack);
 
+/// get background images (one per statistic) of a set of videos with the same frame size (e.g. clips from one fixed camera)
+/// - the histograms of all the videos' frames are summed; the pack's frame range, sampling, and crop settings apply to each video
+/// - the pack's vid_path, convergence, memory limit, checkpoint, and cache settings are ignored
+std::vector<cv::Mat> GetVideoSetBackgrounds(const std::vector<std::string> &vid_paths, const VidBgPack &vidbg_pack);
+
+/// get background images (one per statistic) from the sum of several histogram checkpoints of the same region
+/// - e.g. from processes that each analyzed a different range of frames of one video (see VidBgPack::checkpoint_path)
+std::vector<cv::Mat> MergeBackgroundCheckpoints(const std::vector<std::string> &checkpoint_paths,
+    const std::vector<std::string> &statistics,
+    const int max_threads);
+
 
 #endif //header guard
 
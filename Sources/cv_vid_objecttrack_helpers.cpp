@@ -5,13 +5,17 @@
 
 //local headers
 #include "assign_objects_algo.h"
-#include "async_token_batch_generator.h"
 #include "async_token_process.h"
+#include "cv_frame_cache.h"
+#include "cv_frame_source.h"
 #include "cv_vid_bg_helpers.h"
 #include "cv_vid_frames_generator_algo.h"
+#include "cv_vid_frame_index.h"
+#include "cv_util.h"
 #include "exception_assert.h"
 #include "highlight_objects_algo.h"
 #include "main.h"
+#include "mat_fragment_intermediary.h"
 #include "mat_set_intermediary.h"
 #include "py_dict_consumer.h"
 
@@ -20,6 +24,7 @@
 #include <opencv2/opencv.hpp>   //for video manipulation (mainly)
 
 //standard headers
+#include <algorithm>
 #include <future>
 #include <iostream>
 #include <memory>
@@ -27,10 +32,13 @@
 
 
 /// encapsulates call to async tokenized object tracking analysis
-std::unique_ptr<py::dict> TrackObjectsProcess(cv::VideoCapture &vid,
+std::unique_ptr<py::dict> TrackObjectsProcess(const CvFrameSource &frame_source,
     const VidObjectTrackPack &track_objects_pack,
+    const cv::Mat &background,
     std::vector<TokenProcessorPack<HighlightObjectsAlgo>> &highlight_objects_packs,
-    std::vector<TokenProcessorPack<AssignObjectsAlgo>> &assign_objects_packs)
+    std::vector<TokenProcessorPack<AssignObjectsAlgo>> &assign_objects_packs,
+    const std::shared_ptr<const ChunkPlan> &tile_plan/* = nullptr*/,
+    const int decoder_threads/* = 0*/)
 {
     // we must have the gil so resource cleanup does not cause segfaults
     //TODO: figure out how to release gil here
@@ -45,64 +53,117 @@ std::unique_ptr<py::dict> TrackObjectsProcess(cv::VideoCapture &vid,
     assert(batch_size);
 
     // create crop-window for processing frames
-    cv::Rect frame_dimensions{GetCroppedFrameDims(track_objects_pack.crop_x, track_objects_pack.crop_y, track_objects_pack.crop_width, track_objects_pack.crop_height,
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_WIDTH)),
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_HEIGHT)))};
+    cv::Rect frame_dimensions{GetSourceFrameDims(frame_source, track_objects_pack.crop_x, track_objects_pack.crop_y, track_objects_pack.crop_width, track_objects_pack.crop_height)};
 
     /// create frame generator
 
-    // cap range of frames to analyze at the frame limit
-    long long num_frames{};
-    if (vid.isOpened())
+    // frame index for seeking exactly to the start frame, whose frame count is counted instead of estimated (other
+    //   sources read frames directly)
+    long long num_frames{frame_source.frame_count};
+    std::shared_ptr<const CvVidFrameIndex> frame_index{};
+
+    if (track_objects_pack.use_frame_index && frame_source.type == CvFrameSourceType::VIDEO)
     {
-        num_frames = static_cast<long long>(vid.get(cv::CAP_PROP_FRAME_COUNT));
-        
-        // if frame limit is <= 0 use default (all frames in vid)
-        if (track_objects_pack.frame_limit > 0)
+        auto new_frame_index{std::make_shared<CvVidFrameIndex>()};
+
+        if (cv_vid_frame_index(track_objects_pack.vid_path, *new_frame_index))
         {
-            if (num_frames > track_objects_pack.frame_limit)
-                num_frames = track_objects_pack.frame_limit;
+            num_frames = new_frame_index->frame_count;
+            frame_index = std::move(new_frame_index);
         }
+        else
+            std::cerr << "warning, could not index the frames of video: " << track_objects_pack.vid_path << '\n';
     }
-    else
+
+    // cap range of frames to analyze at the frame limit
+    if (num_frames <= 0)
         return nullptr;
 
+    // if frame limit is <= 0 use default (all frames in vid)
+    if (track_objects_pack.frame_limit > 0)
+    {
+        if (num_frames > track_objects_pack.frame_limit)
+            num_frames = track_objects_pack.frame_limit;
+    }
+
+    // tiles: each batch is one or more frames split into tiles (with overlap), otherwise one whole frame per unit
+    int frames_in_batch{batch_size};
+    int chunks_per_frame{1};
+
+    if (tile_plan)
+    {
+        chunks_per_frame = static_cast<int>(tile_plan->chunks.size());
+        EXCEPTION_ASSERT(chunks_per_frame > 0 && batch_size % chunks_per_frame == 0);
+        EXCEPTION_ASSERT(tile_plan->mat_width == frame_dimensions.width && tile_plan->mat_height == frame_dimensions.height);
+
+        frames_in_batch = batch_size / chunks_per_frame;
+    }
+
+    const int tile_halo_pixels{tile_plan ? track_objects_pack.tile_halo_pixels : 0};
+
     // frame generator packs
     std::vector<TokenGeneratorPack<CvVidFramesGeneratorAlgo>> generator_packs{};
     generator_packs.emplace_back(TokenGeneratorPack<CvVidFramesGeneratorAlgo>{
         batch_size,
-        batch_size,
-        1,  // frames are not chunked
-        track_objects_pack.vid_path,
+        frames_in_batch,
+        chunks_per_frame,
+        frame_source.path,
         track_objects_pack.start_frame, // first frame to grab for analysis (0-indexed)
         track_objects_pack.start_frame + num_frames, // last frame index not to process
         frame_dimensions,
         track_objects_pack.grayscale,
         track_objects_pack.vid_is_grayscale,
-        0,
-        0
+        tile_halo_pixels,
+        tile_halo_pixels,
+        nullptr,    // no control
+        std::vector<long long>{},   // all frames
+        track_objects_pack.bg_window,
+        track_objects_pack.bg_update_interval,
+        background.clone(),   // initial background for rolling background
+        0.0,    // keep every frame
+        frame_index,
+        track_objects_pack.decode_luma,
+        false,  // highlighting writes to its tokens (and tiles overlap), so chunks must be copies
+        tile_plan ? tile_plan->row_divisor : 0,
+        tile_plan ? tile_plan->col_divisor : 0,
+        tile_plan,
+        nullptr,    // no frame cache to write
+        decoder_threads
     });
 
     // frame generator
-    auto frame_gen{std::make_shared<AsyncTokenBatchGenerator<CvVidFramesGeneratorAlgo>>(
+    auto frame_gen{StartFramesGenerator(frame_source,
+        std::move(generator_packs),
         batch_size,
         track_objects_pack.print_timing_report,
         track_objects_pack.token_storage_limit
     )};
 
-    frame_gen->StartGenerator(std::move(generator_packs));
-
     // create mat shuttle that passes frames with highlighted objects to assign objects algo
-    auto mat_shuttle{std::make_shared<MatSetIntermediary>(batch_size,
-        track_objects_pack.print_timing_report,
-        track_objects_pack.token_storage_limit)};
+    // - tiles are stitched back into whole frames first
+    std::shared_ptr<TokenProcessIntermediary<cv::Mat, std::vector<cv::Mat>, bool>> mat_shuttle{};
+
+    if (tile_plan)
+    {
+        mat_shuttle = std::make_shared<MatFragmentIntermediary>(batch_size,
+            track_objects_pack.print_timing_report,
+            track_objects_pack.token_storage_limit,
+            frames_in_batch,
+            tile_plan);
+    }
+    else
+    {
+        mat_shuttle = std::make_shared<MatSetIntermediary>(batch_size,
+            track_objects_pack.print_timing_report,
+            track_objects_pack.token_storage_limit);
+    }
 
     // create consumer that collects final objects archive
     auto dict_collector{std::make_shared<PyDictConsumer>(1,
         track_objects_pack.print_timing_report)};
 
     // create process for highlighting objects
-    using highlight_objects_proc_t = AsyncTokenProcess<HighlightObjectsAlgo, MatSetIntermediary::final_result_type>;
+    using highlight_objects_proc_t = AsyncTokenProcess<HighlightObjectsAlgo, bool>;
     highlight_objects_proc_t highlight_objects_proc{
         batch_size,
         true,
@@ -149,27 +210,126 @@ std::unique_ptr<py::dict> TrackObjectsProcess(cv::VideoCapture &vid,
         return nullptr;
 }
 
+/// compute the background (and optionally the noise image) from the frames selected by bg_frames and bg_sample
+/// - 'read_frame_cache': the frame cache holds the frames to track, so read the background frames from it too
+static std::vector<cv::Mat> GetTrackingBackgrounds(const VidObjectTrackPack &track_objects_pack, const bool read_frame_cache)
+{
+    std::vector<std::string> statistics{"median"};
+
+    if (!track_objects_pack.bg_noise_statistic.empty())
+        statistics.emplace_back(track_objects_pack.bg_noise_statistic);
+
+    // the first frames to track, unless sampling
+    long long frame_limit{track_objects_pack.bg_frames};
+
+    if (track_objects_pack.frame_limit > 0 && track_objects_pack.frame_limit < frame_limit)
+        frame_limit = track_objects_pack.frame_limit;
+
+    // frames are read and converted exactly as for tracking, and the pass never writes a frame cache (it would only hold
+    //  the background frames)
+    VidBgPack vidbg_pack{};
+    vidbg_pack.vid_path = track_objects_pack.vid_path;
+    vidbg_pack.bg_algo = "hist";
+    vidbg_pack.max_threads = track_objects_pack.max_threads;
+    vidbg_pack.frame_limit = track_objects_pack.bg_sample ? -1 : frame_limit;
+    vidbg_pack.grayscale = track_objects_pack.grayscale;
+    vidbg_pack.vid_is_grayscale = track_objects_pack.vid_is_grayscale;
+    vidbg_pack.crop_x = track_objects_pack.crop_x;
+    vidbg_pack.crop_y = track_objects_pack.crop_y;
+    vidbg_pack.crop_width = track_objects_pack.crop_width;
+    vidbg_pack.crop_height = track_objects_pack.crop_height;
+    vidbg_pack.token_storage_limit = track_objects_pack.token_storage_limit;
+    vidbg_pack.print_timing_report = track_objects_pack.print_timing_report;
+    vidbg_pack.temporal_shards = false;
+    vidbg_pack.statistics = statistics;
+    vidbg_pack.memory_limit_mb = 0;
+    vidbg_pack.compact_histograms = false;
+    vidbg_pack.convergence_check_interval = 0;
+    vidbg_pack.sample_frames = track_objects_pack.bg_sample ? track_objects_pack.bg_frames : 0;
+    vidbg_pack.sample_seed = -1;
+    vidbg_pack.start_frame = track_objects_pack.start_frame;
+    vidbg_pack.checkpoint_path = "";
+    vidbg_pack.cache_dir = "";
+    vidbg_pack.dedup_threshold = 0.0;
+    vidbg_pack.use_frame_index = track_objects_pack.use_frame_index;
+    vidbg_pack.decode_luma = track_objects_pack.decode_luma;
+    vidbg_pack.chunk_rows = 0;
+    vidbg_pack.raw_format = track_objects_pack.raw_format;
+    vidbg_pack.frame_cache_path = read_frame_cache ? track_objects_pack.frame_cache_path : "";
+    vidbg_pack.decoder_threads = track_objects_pack.decoder_threads;
+
+    // no need to hold the GIL while the frames are decoded
+    py::gil_scoped_release release_gil{};
+
+    return GetVideoBackgrounds(vidbg_pack);
+}
+
 /// WARNING: can only be called when the python GIL is held
 py::dict TrackObjects(const VidObjectTrackPack &track_objects_pack)
 {
-    // open video file
-    cv::VideoCapture vid{track_objects_pack.vid_path};
+    // open video file (or other source of frames)
+    CvFrameSource frame_source{};
 
-    if (!vid.isOpened())
+    if (!cv_open_frame_source(track_objects_pack.vid_path, track_objects_pack.raw_format, frame_source))
     {
-        std::cerr << "Video file not detected: " << track_objects_pack.vid_path << '\n';
+        std::cerr << "Frame source not detected: " << track_objects_pack.vid_path << '\n';
 
         return py::dict{};
     }
 
     // validate inputs
-    // frame cropping should match background image passed in
-    EXCEPTION_ASSERT(track_objects_pack.highlight_objects_pack.background.data && !track_objects_pack.highlight_objects_pack.background.empty());
+    // frame cropping should match the background image
     cv::Rect temp_frame_dimensions{GetCroppedFrameDims(track_objects_pack.crop_x, track_objects_pack.crop_y, track_objects_pack.crop_width, track_objects_pack.crop_height,
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_WIDTH)),
-        static_cast<int>(vid.get(cv::CAP_PROP_FRAME_HEIGHT)))};
-    EXCEPTION_ASSERT(temp_frame_dimensions.width == track_objects_pack.highlight_objects_pack.background.cols);
-    EXCEPTION_ASSERT(temp_frame_dimensions.height == track_objects_pack.highlight_objects_pack.background.rows);
+        frame_source.frame_width,
+        frame_source.frame_height)};
+
+    // read the cropped grayscale frames from the frame cache (e.g. made while computing the background) if it has them
+    bool frames_from_cache{false};
+
+    if (!track_objects_pack.frame_cache_path.empty() &&
+        frame_source.type == CvFrameSourceType::VIDEO &&
+        (track_objects_pack.grayscale || track_objects_pack.vid_is_grayscale))
+    {
+        const long long min_frames{track_objects_pack.frame_limit > 0 ? track_objects_pack.start_frame + track_objects_pack.frame_limit : -1};
+
+        if (cv_open_frame_cache(track_objects_pack.frame_cache_path,
+                cv_frame_cache_key(frame_source.path, temp_frame_dimensions, track_objects_pack.vid_is_grayscale, track_objects_pack.decode_luma),
+                temp_frame_dimensions,
+                min_frames,
+                frame_source))
+        {
+            std::cout << "Frames read from cache: " << track_objects_pack.frame_cache_path << '\n';
+            frames_from_cache = true;
+        }
+    }
+
+    // background (and noise) to highlight objects against: passed in, or computed from some of the frames to track
+    cv::Mat background{track_objects_pack.highlight_objects_pack.background};
+    cv::Mat noise{track_objects_pack.highlight_objects_pack.noise};
+
+    if (track_objects_pack.bg_frames > 0)
+    {
+        std::vector<cv::Mat> images{GetTrackingBackgrounds(track_objects_pack, frames_from_cache)};
+        const std::size_t expected_images{track_objects_pack.bg_noise_statistic.empty() ? 1u : 2u};
+
+        EXCEPTION_ASSERT_MSG(images.size() == expected_images, "could not compute the background from the video");
+
+        background = images[0];
+
+        if (expected_images > 1)
+            noise = images[1];
+    }
+
+    EXCEPTION_ASSERT(background.data && !background.empty());
+    EXCEPTION_ASSERT(temp_frame_dimensions.width == background.cols);
+    EXCEPTION_ASSERT(temp_frame_dimensions.height == background.rows);
+
+    // the noise image is optional, but if it exists it should line up with the background
+    if (noise.data && !noise.empty())
+    {
+        EXCEPTION_ASSERT(noise.size() == background.size());
+        EXCEPTION_ASSERT(noise.channels() == background.channels());
+    }
 
     // the structuring element should exist
     EXCEPTION_ASSERT(track_objects_pack.highlight_objects_pack.struct_element.data && !track_objects_pack.highlight_objects_pack.struct_element.empty());
@@ -181,6 +341,49 @@ py::dict TrackObjects(const VidObjectTrackPack &track_objects_pack)
     // + 1 -> roll one of the required threads into the additional threads obtained to get the batch size
     int batch_size{GetAdditionalThreads(3, 0, track_objects_pack.max_threads) + 1};
 
+    // the video decoder's extra threads come out of the highlighting threads, so decoding doesn't oversubscribe the cores
+    int decoder_threads{0};
+
+    if (frame_source.type == CvFrameSourceType::VIDEO && track_objects_pack.decoder_threads > 0)
+    {
+        // a fixed count is capped so at least one highlighting thread is left
+        decoder_threads = std::min(track_objects_pack.decoder_threads, batch_size);
+        batch_size -= decoder_threads - 1;
+    }
+
+    // tiled highlighting: each frame is split into row-strip tiles, one per unit (several frames per batch if there are
+    //  more units than tiles)
+    std::shared_ptr<ChunkPlan> tile_plan{};
+    int tiles_per_frame{batch_size};
+
+    if (track_objects_pack.tiles_per_frame > 0 && track_objects_pack.tiles_per_frame < batch_size)
+        tiles_per_frame = track_objects_pack.tiles_per_frame;
+
+    if (track_objects_pack.tile_frames && tiles_per_frame > 1)
+    {
+        // a threshold picked from each tile's own pixels would differ between tiles
+        EXCEPTION_ASSERT_MSG(track_objects_pack.highlight_objects_pack.threshold != -1,
+            "tiled highlighting needs a fixed threshold (not Otsu's)");
+        EXCEPTION_ASSERT(track_objects_pack.tile_halo_pixels >= 0);
+
+        int tile_cols{1};
+        int tile_rows{1};
+        EXCEPTION_ASSERT_MSG(cv_chunk_grid(tiles_per_frame, temp_frame_dimensions.width, temp_frame_dimensions.height, 0, tile_cols, tile_rows),
+            "frames are too small to split into one tile per thread");
+
+        tile_plan = std::make_shared<ChunkPlan>();
+        EXCEPTION_ASSERT(cv_chunk_plan(*tile_plan,
+            temp_frame_dimensions.width,
+            temp_frame_dimensions.height,
+            tile_cols,
+            tile_rows,
+            track_objects_pack.tile_halo_pixels,
+            track_objects_pack.tile_halo_pixels));
+
+        // whole frames per batch
+        batch_size -= batch_size % tiles_per_frame;
+    }
+
     // highlight objects algo packs
     std::vector<TokenProcessorPack<HighlightObjectsAlgo>> highlight_objects_packs{};
     highlight_objects_packs.reserve(batch_size);
@@ -190,8 +393,28 @@ py::dict TrackObjects(const VidObjectTrackPack &track_objects_pack)
         highlight_objects_packs.emplace_back(track_objects_pack.highlight_objects_pack);
 
         // must manually clone the cv::Mats here because their copy constructor only creates a reference
-        highlight_objects_packs[i].background = track_objects_pack.highlight_objects_pack.background.clone();
+        highlight_objects_packs[i].background = background.clone();
         highlight_objects_packs[i].struct_element = track_objects_pack.highlight_objects_pack.struct_element.clone();
+        highlight_objects_packs[i].noise = noise.clone();
+
+        // with a rolling background the frame generator subtracts the background
+        highlight_objects_packs[i].frames_are_bg_diffs = track_objects_pack.bg_window > 0;
+
+        // tiles: each unit only needs the background and noise of its own tile (including the overlap)
+        if (tile_plan)
+        {
+            const BorderedChunk &tile{tile_plan->chunks[i % tiles_per_frame]};
+            const cv::Rect tile_rect{tile.corner_x, tile.corner_y, tile.chunk_width, tile.chunk_height};
+
+            highlight_objects_packs[i].background = background(tile_rect).clone();
+
+            if (noise.data && !noise.empty())
+                highlight_objects_packs[i].noise = noise(tile_rect).clone();
+
+            highlight_objects_packs[i].frames_are_tiles = true;
+            highlight_objects_packs[i].tile_region = tile_rect;
+            highlight_objects_packs[i].frame_size = temp_frame_dimensions.size();
+        }
     }
 
     // there is only one assign objects pack
@@ -200,7 +423,7 @@ py::dict TrackObjects(const VidObjectTrackPack &track_objects_pack)
 
     // call the process
     std::unique_ptr<py::dict> objects_archive{
-        TrackObjectsProcess(vid, track_objects_pack, highlight_objects_packs, assign_objects_packs)};
+        TrackObjectsProcess(frame_source, track_objects_pack, background, highlight_objects_packs, assign_objects_packs, tile_plan, decoder_threads)};
 
     // return the dictionary of tracked objects
     if (objects_archive)
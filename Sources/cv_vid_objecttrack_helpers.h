@@ -16,13 +16,14 @@
 #include <vector>
 
 //forward declarations
-namespace cv {class VideoCapture;}
+struct CvFrameSource;
+struct ChunkPlan;
 
 
 /// settings necessary to track objects in a video
 struct __attribute__ ((visibility("hidden"))) VidObjectTrackPack
 {
-    // path to video
+    // path to video (a directory of images, a .y4m file, or a raw frame file with raw_format also work, see cv_open_frame_source())
     const std::string vid_path{};
 
     // pack of variables for HighlightObjectsAlgo
@@ -57,15 +58,71 @@ struct __attribute__ ((visibility("hidden"))) VidObjectTrackPack
 
     // whether to collect and print timing reports
     const bool print_timing_report{false};
+
+    // number of frames in a sliding window used to keep the background up to date (<= 0 means always use the input background)
+    // - the input background is used until the window is full
+    const int bg_window{0};
+    // number of frames between background updates from the sliding window (<= 0 means bg_window)
+    const int bg_update_interval{0};
+
+    // whether to index the video's keyframes so seeking to start_frame is exact (stored in a sidecar file next to the video)
+    const bool use_frame_index{false};
+
+    // with grayscale or vid_is_grayscale: take the luma plane of the decoded frames instead of converting them to BGR and back
+    // - the background should be computed with the same setting
+    const bool decode_luma{false};
+
+    // whether to highlight each frame as overlapping tiles (one per highlighting thread) instead of one frame per thread
+    // - lowers the latency of each frame; objects are highlighted as in whole frames if they fit within the tile overlap
+    //   (except when an object covers the frame's top-left pixel, which changes the whole frame's hole-filling seed)
+    // - not compatible with automatic (Otsu) thresholds, which would be picked per tile
+    const bool tile_frames{false};
+    // pixels of overlap on each side of a tile (should exceed the size of the largest object plus the structuring element)
+    const int tile_halo_pixels{32};
+    // number of tiles per frame (<= 0 means one per highlighting thread)
+    // - with fewer tiles than threads, several frames are highlighted at once (latency vs throughput)
+    const int tiles_per_frame{0};
+
+    // layout of headerless raw frame files, 'WxH:fmt' (see VidBgPack::raw_format)
+    const std::string raw_format{};
+
+    // frame cache to read the cropped grayscale frames from instead of decoding the video (see VidBgPack::frame_cache_path)
+    // - used only if it was made from the same video, crop, and grayscale mode, and holds the frames to track
+    const std::string frame_cache_path{};
+
+    // number of frames to compute the background from before tracking (<= 0 means use the input background)
+    // - replaces highlight_objects_pack.background; only these frames are decoded for the background, then tracking starts
+    //   at start_frame (so they are decoded twice, instead of decoding the whole video for a separate background pass)
+    const long long bg_frames{0};
+    // whether the background frames are sampled from across the video after start_frame (otherwise the first bg_frames
+    //   frames to track)
+    const bool bg_sample{false};
+    // with bg_frames: statistic for a noise image from the same pass, replacing highlight_objects_pack.noise (e.g. 'mad';
+    //   empty means keep the input noise image)
+    const std::string bg_noise_statistic{};
+
+    // max number of threads the video decoder may use internally (<= 0 means the decoder backend's default, which can
+    //   oversubscribe the cores; see VidBgPack::decoder_threads)
+    // - the decoder's extra threads are taken from the highlighting threads (at most all but one of them)
+    const int decoder_threads{0};
 };
 
 /// encapsulates call to async tokenized object tracking analysis
-std::unique_ptr<py::dict> TrackObjectsProcess(cv::VideoCapture &vid,
+/// - 'background': the whole background (the initial background of a rolling background)
+/// - if there is a tile plan, each batch holds (number of highlight packs / tiles per frame) frames, each highlight pack
+///   handles the tile with its index modulo the tiles per frame (its background must be cut to that tile), and frames
+///   are split with the plan and stitched back together before objects are assigned
+/// - 'decoder_threads': max number of threads the video decoder may use (<= 0 means the backend's default)
+std::unique_ptr<py::dict> TrackObjectsProcess(const CvFrameSource &frame_source,
     const VidObjectTrackPack &track_objects_pack,
+    const cv::Mat &background,
     std::vector<TokenProcessorPack<HighlightObjectsAlgo>> &highlight_objects_packs,
-    std::vector<TokenProcessorPack<AssignObjectsAlgo>> &assign_objects_packs);
+    std::vector<TokenProcessorPack<AssignObjectsAlgo>> &assign_objects_packs,
+    const std::shared_ptr<const ChunkPlan> &tile_plan = nullptr,
+    const int decoder_threads = 0);
 
 /// track objects in a video and return record of objects tracked
+/// - with bg_frames, the background (and noise) is computed from the video first
 /// WARNING: can only be called when the python GIL is held
 py::dict TrackObjects(const VidObjectTrackPack &trackbubble_pack);
 
@@ -145,6 +145,10 @@ int main(int argc, char* argv[])
     //rand_tests::test_objecthighlighting(background_frame, cl_pack, true);
     //rand_tests::test_embedded_python();
     //rand_tests::test_timing_numpyconverter(2000, true);
+    //rand_tests::test_timing_chunk_layouts(200);
+    //rand_tests::test_tiled_highlighting();
+    //rand_tests::test_histogram_statistics();
+    //rand_tests::test_histogram_checkpoints();
     //rand_tests::test_exception_assert();
 
     rand_tests::demo_trackobjects(cl_pack, background_frame);
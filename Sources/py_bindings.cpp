@@ -12,15 +12,34 @@
 //third party headers
 #include <opencv2/opencv.hpp>   //for video manipulation (mainly)
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 //standard headers
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 
 namespace py = pybind11;
 
+
+/// convert background images to python: one image if at most one statistic was requested, otherwise a list of images
+///   (one per statistic)
+static py::object BackgroundImagesToPy(const std::vector<cv::Mat> &images, const std::size_t num_statistics)
+{
+    if (num_statistics <= 1)
+        return py::cast(images.empty() ? cv::Mat{} : images.front());
+
+    py::list image_list{};
+
+    for (const auto &image : images)
+        image_list.append(image);
+
+    return std::move(image_list);
+}
+
 /// create module
 /// NOTE: must update __init__.py file when new symbols are added
 PYBIND11_MODULE(_core, mod)
@@ -45,7 +64,25 @@ PYBIND11_MODULE(_core, mod)
                 const int,
                 const int,
                 const int,
-                const bool>(),
+                const bool,
+                const bool,
+                const std::vector<std::string>&,
+                const long long,
+                const bool,
+                const int,
+                const double,
+                const long long,
+                const long long,
+                const long long,
+                const std::string&,
+                const std::string&,
+                const double,
+                const bool,
+                const bool,
+                const int,
+                const std::string&,
+                const std::string&,
+                const int>(),
                 py::arg("vid_path"),
                 py::arg("bg_algo") = "hist",
                 py::arg("max_threads") = -1,            // only set to limit how many threads can be used
@@ -57,14 +94,86 @@ PYBIND11_MODULE(_core, mod)
                 py::arg("crop_width") = 0,
                 py::arg("crop_height") = 0,
                 py::arg("token_storage_limit") = 10,
-                py::arg("print_timing_report") = false);
+                py::arg("print_timing_report") = false,
+                py::arg("temporal_shards") = false,
+                py::arg("statistics") = std::vector<std::string>{},
+                py::arg("memory_limit_mb") = 0,         // only set to limit how much RAM the histograms can use
+                py::arg("compact_histograms") = false,
+                py::arg("convergence_check_interval") = 0,
+                py::arg("convergence_tolerance") = 0.5,
+                py::arg("sample_frames") = 0,
+                py::arg("sample_seed") = -1,
+                py::arg("start_frame") = 0,
+                py::arg("checkpoint_path") = "",
+                py::arg("cache_dir") = "",
+                py::arg("dedup_threshold") = 0.0,
+                py::arg("use_frame_index") = false,
+                py::arg("decode_luma") = false,
+                py::arg("chunk_rows") = 0,
+                py::arg("raw_format") = "",
+                py::arg("frame_cache_path") = "",
+                py::arg("decoder_threads") = 0);
 
     /// funct GetVideoBackground()
-    mod.def("GetVideoBackground", &GetVideoBackground, "Get the background of an OpenCV video.",
-        // no need to hold the GIL in long-running C++ code
-        py::call_guard<py::gil_scoped_release>(),
+    /// - returns one image or a list of images, see BackgroundImagesToPy()
+    mod.def("GetVideoBackground",
+        [](const VidBgPack &vidbg_pack) -> py::object
+        {
+            std::vector<cv::Mat> images{};
+
+            {
+                // no need to hold the GIL in long-running C++ code
+                py::gil_scoped_release release_gil{};
+
+                images = GetVideoBackgrounds(vidbg_pack);
+            }
+
+            return BackgroundImagesToPy(images, vidbg_pack.statistics.size());
+        },
+        "Get the background of an OpenCV video.",
+        py::arg("pack"));   //VidBgPack
+
+    /// funct GetVideoSetBackground()
+    /// - returns one image or a list of images, see BackgroundImagesToPy()
+    mod.def("GetVideoSetBackground",
+        [](const std::vector<std::string> &vid_paths, const VidBgPack &vidbg_pack) -> py::object
+        {
+            std::vector<cv::Mat> images{};
+
+            {
+                // no need to hold the GIL in long-running C++ code
+                py::gil_scoped_release release_gil{};
+
+                images = GetVideoSetBackgrounds(vid_paths, vidbg_pack);
+            }
+
+            return BackgroundImagesToPy(images, vidbg_pack.statistics.size());
+        },
+        "Get one background for a set of OpenCV videos with the same frame size.",
+        py::arg("vid_paths"),
         py::arg("pack"));   //VidBgPack
 
+    /// funct MergeBackgroundCheckpoints()
+    /// - returns one image or a list of images, see BackgroundImagesToPy()
+    mod.def("MergeBackgroundCheckpoints",
+        [](const std::vector<std::string> &checkpoint_paths, const std::vector<std::string> &statistics, const int max_threads) -> py::object
+        {
+            std::vector<cv::Mat> images{};
+
+            {
+                // no need to hold the GIL in long-running C++ code
+                py::gil_scoped_release release_gil{};
+
+                images = MergeBackgroundCheckpoints(checkpoint_paths, statistics, max_threads);
+            }
+
+            return BackgroundImagesToPy(images, statistics.size());
+        },
+        "Get the background from the histogram checkpoints of several background runs.",
+        py::arg("checkpoint_paths"),
+        py::arg("statistics") = std::vector<std::string>{},
+        py::arg("max_threads") = 1);
+
     /// struct TokenProcessorPack<HighlightObjectsAlgo>
     py::class_<TokenProcessorPack<HighlightObjectsAlgo>>(mod, "HighlightObjectsPack")
         .def(py::init<cv::Mat,
@@ -74,7 +183,9 @@ PYBIND11_MODULE(_core, mod)
                 const int,
                 const int,
                 const int,
-                const int>(),
+                const int,
+                cv::Mat,
+                const double>(),
                 py::arg("background"),
                 py::arg("struct_element"),
                 py::arg("threshold"),
@@ -82,7 +193,9 @@ PYBIND11_MODULE(_core, mod)
                 py::arg("threshold_hi"),
                 py::arg("min_size_hyst"),
                 py::arg("min_size_threshold"),
-                py::arg("width_border"));
+                py::arg("width_border"),
+                py::arg("noise") = cv::Mat{},           // optional per-pixel noise image (None -> global thresholds)
+                py::arg("noise_scale") = 1.0);
 
     /// struct TokenProcessorPack<AssignObjectsAlgo>
     py::class_<TokenProcessorPack<AssignObjectsAlgo>>(mod, "AssignObjectsPack")
@@ -109,7 +222,20 @@ PYBIND11_MODULE(_core, mod)
                 const int,
                 const int,
                 const int,
-                const bool>(),
+                const bool,
+                const int,
+                const int,
+                const bool,
+                const bool,
+                const bool,
+                const int,
+                const int,
+                const std::string,
+                const std::string,
+                const long long,
+                const bool,
+                const std::string,
+                const int>(),
                 py::arg("vid_path"),
                 py::arg("highlight_objects_pack"),
                 py::arg("assign_objects_pack"),
@@ -123,7 +249,20 @@ PYBIND11_MODULE(_core, mod)
                 py::arg("crop_width") = 0,
                 py::arg("crop_height") = 0,
                 py::arg("token_storage_limit") = 10,
-                py::arg("print_timing_report") = false);
+                py::arg("print_timing_report") = false,
+                py::arg("bg_window") = 0,
+                py::arg("bg_update_interval") = 0,
+                py::arg("use_frame_index") = false,
+                py::arg("decode_luma") = false,
+                py::arg("tile_frames") = false,
+                py::arg("tile_halo_pixels") = 32,
+                py::arg("tiles_per_frame") = 0,
+                py::arg("raw_format") = "",
+                py::arg("frame_cache_path") = "",
+                py::arg("bg_frames") = 0,
+                py::arg("bg_sample") = false,
+                py::arg("bg_noise_statistic") = "",
+                py::arg("decoder_threads") = 0);
 
     /// funct TrackObjects()
     mod.def("TrackObjects", &TrackObjects, "Track objects in an OpenCV video.",
@@ -7,8 +7,11 @@
 #include "assign_objects_algo.h"
 #include "cv_vid_bg_helpers.h"
 #include "cv_vid_objecttrack_helpers.h"
+#include "cv_util.h"
+#include "element_histograms.h"
 #include "exception_assert.h"
 #include "highlight_objects_algo.h"
+#include "histogram_checkpoint.h"
 #include "main.h"
 #include "ndarray_converter.h"
 #include "project_config.h"
@@ -22,9 +25,17 @@
 #include <pybind11/pybind11.h>
 
 //standard headers
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
 
 
 namespace py = pybind11;
@@ -257,6 +268,425 @@ void test_timing_numpyconverter(const int num_rounds, const bool include_convers
         (timer_report.total_time / timer_report.num_intervals).count() << " ms avg\n";
 }
 
+/// time splitting a frame into chunks, updating per-chunk histograms, and reassembling the frame, for each chunk grid
+///  that divides num_chunks (row strips first, column strips last)
+void test_timing_chunk_layouts(const int num_rounds, const int num_chunks)
+{
+    EXCEPTION_ASSERT(num_rounds > 0 && num_chunks > 0);
+
+    // synthetic 1080p grayscale frame
+    cv::Mat test_frame{1080, 1920, CV_8UC1};
+    cv::randu(test_frame, cv::Scalar{0}, cv::Scalar{256});
+
+    for (int chunk_rows{num_chunks}; chunk_rows >= 1; chunk_rows--)
+    {
+        if (num_chunks % chunk_rows != 0)
+            continue;
+
+        const int chunk_cols{num_chunks / chunk_rows};
+        std::vector<ElementHistograms<std::uint16_t>> chunk_histograms(num_chunks);
+        cv::Mat result_frame{};
+
+        // chunk layout (computed once, like the background pipelines)
+        ChunkPlan chunk_plan{};
+        EXCEPTION_ASSERT(cv_chunk_plan(chunk_plan, test_frame.cols, test_frame.rows, chunk_cols, chunk_rows));
+
+        TSIntervalTimer timer{};
+        auto start_time{timer.GetTime()};
+
+        for (int round{0}; round < num_rounds; round++)
+        {
+            // split (copies, like the background generators without shared chunk data)
+            std::vector<std::unique_ptr<cv::Mat>> chunks{};
+            EXCEPTION_ASSERT(cv_mat_to_chunks(test_frame, chunks, chunk_plan));
+
+            // scan
+            std::vector<cv::Mat> chunk_mats{};
+            chunk_mats.reserve(chunks.size());
+
+            for (std::size_t chunk_index{0}; chunk_index < chunks.size(); chunk_index++)
+            {
+                chunk_histograms[chunk_index].ConsumeMat(*chunks[chunk_index]);
+                chunk_mats.emplace_back(std::move(*chunks[chunk_index]));
+            }
+
+            // reassemble (in place after the first round)
+            EXCEPTION_ASSERT(cv_mat_from_chunks(result_frame, chunk_mats, chunk_plan));
+
+            start_time = timer.AddInterval(start_time);
+        }
+
+        // print timer report
+        auto timer_report{timer.GetReport<std::chrono::milliseconds>()};
+        auto interval_ms{timer_report.total_time.count()};
+        auto interval_s_float{static_cast<double>(interval_ms/1000.0)};
+        std::cout << "chunk layout " << chunk_rows << " rows x " << chunk_cols << " cols timing: " << interval_s_float << " s; " <<
+            timer_report.num_intervals << " rounds; " <<
+            (timer_report.total_time / timer_report.num_intervals).count() << " ms avg\n";
+    }
+}
+
+/// check that tiled highlighting matches whole-frame highlighting, including objects on the frame's border and objects
+///  crossing the seams between tiles
+void test_tiled_highlighting()
+{
+    // synthetic frame: objects darker than a flat background
+    const cv::Mat background{120, 200, CV_8UC1, cv::Scalar{200}};
+    cv::Mat test_frame{background.clone()};
+
+    // a ring cut by the frame's left edge (its inside touches the border, but not the fill seed), and rings across the
+    //  seams between tiles (all fit within the tile overlap)
+    cv::circle(test_frame, cv::Point{0, 40}, 14, cv::Scalar{50}, 5);
+    cv::circle(test_frame, cv::Point{100, 40}, 15, cv::Scalar{50}, 5);
+    cv::circle(test_frame, cv::Point{160, 80}, 15, cv::Scalar{50}, 5);
+
+    TokenProcessorPack<HighlightObjectsAlgo> objects_pack{
+        background,
+        cv::getStructuringElement(cv::MorphShapes::MORPH_ELLIPSE, cv::Size{3, 3}),
+        14,
+        7,
+        16,
+        20,
+        20,
+        5
+    };
+
+    // whole frame
+    HighlightObjectsAlgo whole_frame_highlighting{objects_pack};
+    whole_frame_highlighting.Insert(std::make_unique<cv::Mat>(test_frame.clone()));
+    std::unique_ptr<cv::Mat> whole_frame_result{whole_frame_highlighting.TryGetResult()};
+    EXCEPTION_ASSERT(whole_frame_result);
+
+    // three row-strip tiles with overlap, stitched back together
+    ChunkPlan tile_plan{};
+    EXCEPTION_ASSERT(cv_chunk_plan(tile_plan, test_frame.cols, test_frame.rows, 1, 3, 32, 32));
+
+    std::vector<std::unique_ptr<cv::Mat>> tiles{};
+    EXCEPTION_ASSERT(cv_mat_to_chunks(test_frame, tiles, tile_plan));
+
+    std::vector<cv::Mat> tile_results{};
+    tile_results.reserve(tiles.size());
+
+    for (std::size_t tile_index{0}; tile_index < tiles.size(); tile_index++)
+    {
+        const BorderedChunk &tile{tile_plan.chunks[tile_index]};
+        const cv::Rect tile_rect{tile.corner_x, tile.corner_y, tile.chunk_width, tile.chunk_height};
+
+        TokenProcessorPack<HighlightObjectsAlgo> tile_pack{objects_pack};
+        tile_pack.background = background(tile_rect).clone();
+        tile_pack.frames_are_tiles = true;
+        tile_pack.tile_region = tile_rect;
+        tile_pack.frame_size = test_frame.size();
+
+        HighlightObjectsAlgo tile_highlighting{tile_pack};
+        tile_highlighting.Insert(std::move(tiles[tile_index]));
+        std::unique_ptr<cv::Mat> tile_result{tile_highlighting.TryGetResult()};
+        EXCEPTION_ASSERT(tile_result);
+
+        tile_results.emplace_back(std::move(*tile_result));
+    }
+
+    cv::Mat tiled_result{};
+    EXCEPTION_ASSERT(cv_mat_from_chunks(tiled_result, tile_results, tile_plan));
+
+    // compare
+    cv::Mat differences{};
+    cv::compare(*whole_frame_result, tiled_result, differences, cv::CMP_NE);
+    const int num_differences{cv::countNonZero(differences)};
+
+    if (num_differences == 0)
+        std::cout << "tiled highlighting test succeeded!\n";
+    else
+        std::cout << "tiled highlighting test failed! " << num_differences << " pixels differ from whole-frame highlighting\n";
+}
+
+/// check the histogram statistics against the same statistics computed directly from each element's sorted values
+void test_histogram_statistics()
+{
+    // synthetic frames: a small stack of random 3-channel frames with a narrow value range (so values repeat)
+    const int num_frames{41};
+    cv::RNG rng{12345};
+    std::vector<cv::Mat> frames{};
+    ElementHistograms<std::uint16_t> histograms{HistogramOverflow::SATURATE};
+
+    for (int frame_index{0}; frame_index < num_frames; frame_index++)
+    {
+        cv::Mat frame{6, 5, CV_8UC3};
+        rng.fill(frame, cv::RNG::UNIFORM, 0, 24);
+        histograms.ConsumeMat(frame);
+        frames.emplace_back(std::move(frame));
+    }
+
+    const std::vector<std::string> statistic_names{"median", "p10", "p97.5", "mode", "mean", "tmean10", "iqr", "mad"};
+    const std::vector<cv::Mat> statistics{histograms.Statistics(GetHistogramStatistics(statistic_names))};
+    EXCEPTION_ASSERT(statistics.size() == statistic_names.size());
+
+    // brute force: statistics of one element's sorted values
+    auto percentile = [](const std::vector<int> &values, const double percent) -> int
+    {
+        const std::size_t rank{static_cast<std::size_t>(static_cast<double>(values.size())*percent/100.0)};
+
+        return values[std::min(rank, values.size() - 1)];
+    };
+
+    auto mode = [](const std::vector<int> &values) -> int
+    {
+        // lowest value wins ties
+        int best_value{values.front()};
+        std::ptrdiff_t best_count{0};
+
+        for (const int value : values)
+        {
+            const std::ptrdiff_t count{std::count(values.begin(), values.end(), value)};
+
+            if (count > best_count || (count == best_count && value < best_value))
+            {
+                best_value = value;
+                best_count = count;
+            }
+        }
+
+        return best_value;
+    };
+
+    auto trimmed_mean = [](const std::vector<int> &values, const double trim_percent) -> int
+    {
+        const std::size_t num_trimmed{static_cast<std::size_t>(static_cast<double>(values.size())*trim_percent/100.0)};
+        std::size_t rank_begin{num_trimmed};
+        std::size_t rank_end{values.size() - num_trimmed};
+
+        if (rank_end <= rank_begin)
+        {
+            rank_begin = (values.size() - 1)/2;
+            rank_end = rank_begin + 1;
+        }
+
+        const int sum{std::accumulate(values.begin() + rank_begin, values.begin() + rank_end, 0)};
+        const int count{static_cast<int>(rank_end - rank_begin)};
+
+        return (sum + count/2)/count;
+    };
+
+    auto median_absolute_deviation = [&percentile](const std::vector<int> &values) -> int
+    {
+        const int median{percentile(values, 50.0)};
+        std::vector<int> deviations{};
+
+        for (const int value : values)
+            deviations.emplace_back(std::abs(value - median));
+
+        std::sort(deviations.begin(), deviations.end());
+
+        return percentile(deviations, 50.0);
+    };
+
+    // compare every element
+    const std::size_t num_elements{histograms.NumElements()};
+    std::vector<int> num_differences(statistics.size(), 0);
+
+    for (std::size_t element_index{0}; element_index < num_elements; element_index++)
+    {
+        std::vector<int> values{};
+
+        for (const cv::Mat &frame : frames)
+            values.emplace_back(frame.data[element_index]);
+
+        std::sort(values.begin(), values.end());
+
+        const std::vector<int> expected{
+                percentile(values, 50.0),
+                percentile(values, 10.0),
+                percentile(values, 97.5),
+                mode(values),
+                trimmed_mean(values, 0.0),
+                trimmed_mean(values, 10.0),
+                percentile(values, 75.0) - percentile(values, 25.0),
+                median_absolute_deviation(values)
+            };
+
+        for (std::size_t statistic_index{0}; statistic_index < statistics.size(); statistic_index++)
+        {
+            if (statistics[statistic_index].data[element_index] != expected[statistic_index])
+                num_differences[statistic_index]++;
+        }
+    }
+
+    bool succeeded{true};
+
+    for (std::size_t statistic_index{0}; statistic_index < statistics.size(); statistic_index++)
+    {
+        if (num_differences[statistic_index] == 0)
+            continue;
+
+        std::cout << "histogram statistics test failed! " << num_differences[statistic_index] << " of " << num_elements <<
+            " elements differ from brute force for '" << statistic_names[statistic_index] << "'\n";
+        succeeded = false;
+    }
+
+    if (succeeded)
+        std::cout << "histogram statistics test succeeded!\n";
+}
+
+/// check that histogram checkpoints survive a save/load round trip, that loading them into a narrower count type halves
+///  each element's counts instead of clamping them, and that merging checkpoints matches a single pass over their frames
+void test_histogram_checkpoints()
+{
+    // synthetic frames: few distinct values, so bins count past 255
+    const int num_frames{900};
+    cv::RNG rng{54321};
+    std::vector<cv::Mat> frames{};
+
+    for (int frame_index{0}; frame_index < num_frames; frame_index++)
+    {
+        cv::Mat frame{4, 3, CV_8UC1};
+        rng.fill(frame, cv::RNG::UNIFORM, 0, 3);
+        frames.emplace_back(std::move(frame));
+    }
+
+    ElementHistograms<std::uint16_t> histograms_16{HistogramOverflow::SATURATE};
+    ElementHistograms<std::uint32_t> histograms_32{HistogramOverflow::SATURATE};
+    ElementHistograms<std::uint16_t> first_half{HistogramOverflow::SATURATE};
+    ElementHistograms<std::uint16_t> second_half{HistogramOverflow::SATURATE};
+
+    for (int frame_index{0}; frame_index < num_frames; frame_index++)
+    {
+        histograms_16.ConsumeMat(frames[frame_index]);
+        histograms_32.ConsumeMat(frames[frame_index]);
+
+        if (frame_index < num_frames/2)
+            first_half.ConsumeMat(frames[frame_index]);
+        else
+            second_half.ConsumeMat(frames[frame_index]);
+    }
+
+    const std::string path_16{cv::tempfile(".bin")};
+    const std::string path_32{cv::tempfile(".bin")};
+    const std::string path_first_half{cv::tempfile(".bin")};
+    const std::string path_second_half{cv::tempfile(".bin")};
+    SaveHistogramCheckpoint(histograms_16, 0, num_frames, path_16);
+    SaveHistogramCheckpoint(histograms_32, 0, num_frames, path_32);
+    SaveHistogramCheckpoint(first_half, 0, num_frames/2, path_first_half);
+    SaveHistogramCheckpoint(second_half, num_frames/2, num_frames, path_second_half);
+
+    const std::size_t num_elements{histograms_16.NumElements()};
+    bool succeeded{true};
+
+    // same count type: counts come back exactly
+    auto count_exact_differences = [num_elements](const auto &expected, const auto &loaded) -> int
+    {
+        int num_differences{0};
+
+        for (std::size_t bin{0}; bin < histogram_checkpoint_bins; bin++)
+        {
+            for (std::size_t element_index{0}; element_index < num_elements; element_index++)
+                num_differences += (expected.BinCounts(bin)[element_index] != loaded.BinCounts(bin)[element_index]);
+        }
+
+        return num_differences;
+    };
+
+    const ElementHistograms<std::uint16_t> loaded_16{LoadHistogramCheckpoint<std::uint16_t>(path_16)};
+    const ElementHistograms<std::uint32_t> loaded_32{LoadHistogramCheckpoint<std::uint32_t>(path_32)};
+    const int round_trip_differences{count_exact_differences(histograms_16, loaded_16) + count_exact_differences(histograms_32, loaded_32)};
+
+    if (round_trip_differences != 0 || loaded_16.FramesCounted() != num_frames || loaded_32.FramesCounted() != num_frames)
+    {
+        std::cout << "histogram checkpoints test failed! " << round_trip_differences << " bins changed in a save/load round trip\n";
+        succeeded = false;
+    }
+
+    // narrower count type: each element's counts are halved until its largest bin fits, and non-zero counts stay non-zero
+    auto count_halving_differences = [num_elements](const auto &expected, const ElementHistograms<unsigned char> &loaded) -> int
+    {
+        int num_differences{0};
+
+        for (std::size_t element_index{0}; element_index < num_elements; element_index++)
+        {
+            std::uintmax_t largest_count{0};
+
+            for (std::size_t bin{0}; bin < histogram_checkpoint_bins; bin++)
+                largest_count = std::max<std::uintmax_t>(largest_count, expected.BinCounts(bin)[element_index]);
+
+            int shift{0};
+
+            while ((largest_count >> shift) > 255)
+                shift++;
+
+            for (std::size_t bin{0}; bin < histogram_checkpoint_bins; bin++)
+            {
+                const std::uintmax_t count{expected.BinCounts(bin)[element_index]};
+                const std::uintmax_t halved_count{count && !(count >> shift) ? 1 : count >> shift};
+
+                num_differences += (loaded.BinCounts(bin)[element_index] != halved_count);
+            }
+        }
+
+        return num_differences;
+    };
+
+    const ElementHistograms<unsigned char> narrowed_16{LoadHistogramCheckpoint<unsigned char>(path_16)};
+    const ElementHistograms<unsigned char> narrowed_32{LoadHistogramCheckpoint<unsigned char>(path_32)};
+    const int halving_differences{count_halving_differences(histograms_16, narrowed_16) + count_halving_differences(histograms_32, narrowed_32)};
+
+    if (halving_differences != 0)
+    {
+        std::cout << "histogram checkpoints test failed! " << halving_differences << " bins weren't halved when loaded as 8-bit\n";
+        succeeded = false;
+    }
+
+    // merged halves: same median as one pass over all frames
+    const std::vector<cv::Mat> merged_medians{MergeBackgroundCheckpoints({path_first_half, path_second_half}, {"median"}, 1)};
+    EXCEPTION_ASSERT(merged_medians.size() == 1);
+
+    cv::Mat median_differences{};
+    cv::compare(merged_medians[0], histograms_16.Median(), median_differences, cv::CMP_NE);
+    const int num_median_differences{cv::countNonZero(median_differences)};
+
+    if (num_median_differences != 0)
+    {
+        std::cout << "histogram checkpoints test failed! " << num_median_differences << " elements of the merged median differ\n";
+        succeeded = false;
+    }
+
+    // merged with a halved checkpoint: the 16-bit checkpoint is halved to 8 bits before merging, so its relative counts
+    //  decide the median (clamping its 700 and 500 counts to 255 each would let the 10 extra frames flip the median to 20)
+    const cv::Mat low_frame{2, 2, CV_8UC1, cv::Scalar{10}};
+    const cv::Mat high_frame{2, 2, CV_8UC1, cv::Scalar{20}};
+    ElementHistograms<std::uint16_t> counted_histograms{HistogramOverflow::SATURATE};
+    ElementHistograms<unsigned char> halved_histograms{HistogramOverflow::HALVE};
+
+    for (int frame_index{0}; frame_index < 700; frame_index++)
+        counted_histograms.ConsumeMat(low_frame);
+    for (int frame_index{0}; frame_index < 500; frame_index++)
+        counted_histograms.ConsumeMat(high_frame);
+    for (int frame_index{0}; frame_index < 10; frame_index++)
+        halved_histograms.ConsumeMat(high_frame);
+
+    const std::string path_counted{cv::tempfile(".bin")};
+    const std::string path_halved{cv::tempfile(".bin")};
+    SaveHistogramCheckpoint(counted_histograms, 0, 1200, path_counted);
+    SaveHistogramCheckpoint(halved_histograms, 1200, 1210, path_halved);
+
+    const std::vector<cv::Mat> halved_medians{MergeBackgroundCheckpoints({path_counted, path_halved}, {"median"}, 1)};
+    EXCEPTION_ASSERT(halved_medians.size() == 1);
+
+    cv::Mat halved_median_differences{};
+    cv::compare(halved_medians[0], low_frame, halved_median_differences, cv::CMP_NE);
+    const int num_halved_differences{cv::countNonZero(halved_median_differences)};
+
+    if (num_halved_differences != 0)
+    {
+        std::cout << "histogram checkpoints test failed! " << num_halved_differences << " elements of the median merged with a halved checkpoint differ\n";
+        succeeded = false;
+    }
+
+    for (const std::string &path : {path_16, path_32, path_first_half, path_second_half, path_counted, path_halved})
+        std::remove(path.c_str());
+
+    if (succeeded)
+        std::cout << "histogram checkpoints test succeeded!\n";
+}
+
 /// test exception assert
 void test_exception_assert()
 {
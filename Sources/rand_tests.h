@@ -23,6 +23,12 @@ void test_objecthighlighting(cv::Mat &background_frame, const CommandLinePack &c
 void test_assignobjects(cv::Mat &test_frame);
 
 void test_timing_numpyconverter(const int num_rounds, const bool include_conversion = false);
+void test_timing_chunk_layouts(const int num_rounds, const int num_chunks = 8);
+
+void test_tiled_highlighting();
+
+void test_histogram_statistics();
+void test_histogram_checkpoints();
 
 void test_exception_assert();
 